@@ -231,21 +231,20 @@ create_iso() {
 create_ramdisk() {
     echo -e "${BLUE}[INFO]${NC} Creating embedded ramdisk..."
     
-    # 256KB Ramdisk
-    dd if=/dev/zero of="$BUILD_DIR/ramdisk.img" bs=1k count=256 status=none
-    
-    # Format as FAT12 (Small) or FAT32?
-    # FAT32 requires minimum clusters. 256KB is too small for FAT32 usually.
-    # We will use FAT12/16 (mkfs.vfat handles it automatically based on size usually)
-    # Force minimal FAT32 if possible, or support FAT12 in driver?
-    # My driver expects BPB structure which is mostly compatible, but FAT offset calculation differs.
-    # Let's try standard mkfs.vfat, it likely picks FAT12. 
-    # My FAT32 driver might fail if it's FAT12.
-    # TRICK: Make it 33MB sparse file? No, embedded.
-    # Workaround: Use FAT32 with forced params or update driver to support FAT12 BPB?
-    # Actually, easiest is to Create a "Larger" image but cut it? No.
-    # Let's try to format as FAT32 explicitly.
-    # mkfs.vfat -F 32 -I ... might complain.
+    # With the RDZ packer available the image is built as a full-size
+    # (33MB, enough clusters for a real FAT32) raw disk and compressed in
+    # 64KB LZ4 chunks; the kernel decompresses chunks on first access.
+    # Without it, fall back to a small raw image embedded as-is.
+    local HOST_CC="${HOST_CC:-cc}"
+    local RAW_KB=256
+    if $HOST_CC -O2 -o "$BUILD_DIR/mkrdz" tools/mkrdz.c 2>/dev/null; then
+        RAW_KB=33792
+    else
+        echo -e "${YELLOW}[WARN]${NC} Could not build tools/mkrdz, ramdisk will be uncompressed"
+        rm -f "$BUILD_DIR/mkrdz"
+    fi
+    
+    dd if=/dev/zero of="$BUILD_DIR/ramdisk.img" bs=1k count=$RAW_KB status=none
     
     if command -v mkfs.vfat >/dev/null 2>&1; then
         mkfs.vfat -F 32 -I "$BUILD_DIR/ramdisk.img" || mkfs.vfat -I "$BUILD_DIR/ramdisk.img"
@@ -256,6 +255,16 @@ create_ramdisk() {
             mcopy -i "$BUILD_DIR/ramdisk.img" "$BUILD_DIR/README.TXT" ::/README.TXT
         fi
         
+        # Compress (the symbol names depend on the file name, so keep it)
+        if [ -x "$BUILD_DIR/mkrdz" ]; then
+            echo -e "  ${CYAN}→${NC} Compressing..."
+            mv "$BUILD_DIR/ramdisk.img" "$BUILD_DIR/ramdisk.raw"
+            if ! "$BUILD_DIR/mkrdz" "$BUILD_DIR/ramdisk.raw" "$BUILD_DIR/ramdisk.img"; then
+                echo -e "${YELLOW}[WARN]${NC} mkrdz failed, embedding raw image"
+                cp "$BUILD_DIR/ramdisk.raw" "$BUILD_DIR/ramdisk.img"
+            fi
+        fi
+        
         # Convert to Object File
         # We cd into build dir to keep symbols clean (_binary_ramdisk_img_start)
         echo -e "  ${CYAN}→${NC} Converting to ELF object..."
@@ -0,0 +1,150 @@
+/**
+ * OpenWare OS - Directory Entry Cache
+ * Copyright (c) 2026 Ventryx Inc. All rights reserved.
+ */
+
+#include "dcache.h"
+#include "../include/memory.h"
+
+static dentry_t* hash_table[DCACHE_BUCKETS];
+static dentry_t* lru_head = 0;
+static dentry_t* lru_tail = 0;
+static dcache_stats_t stats;
+
+static uint32_t dentry_hash(fs_node_t* parent, const char* name) {
+    uint32_t h = 2166136261u ^ ((uint32_t)parent >> 4);    /* FNV-1a */
+    while (*name) {
+        h ^= (uint8_t)*name++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static bool name_equals(const char* a, const char* b) {
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+static void lru_unlink(dentry_t* d) {
+    if (d->lru_prev) d->lru_prev->lru_next = d->lru_next;
+    else lru_head = d->lru_next;
+    if (d->lru_next) d->lru_next->lru_prev = d->lru_prev;
+    else lru_tail = d->lru_prev;
+    d->lru_prev = d->lru_next = 0;
+}
+
+static void lru_push_front(dentry_t* d) {
+    d->lru_prev = 0;
+    d->lru_next = lru_head;
+    if (lru_head) lru_head->lru_prev = d;
+    lru_head = d;
+    if (!lru_tail) lru_tail = d;
+}
+
+static void dentry_free(dentry_t* d) {
+    dentry_t** link = &hash_table[d->hash & (DCACHE_BUCKETS - 1)];
+    while (*link) {
+        if (*link == d) {
+            *link = d->hash_next;
+            break;
+        }
+        link = &(*link)->hash_next;
+    }
+    lru_unlink(d);
+    
+    stats.entries--;
+    stats.bytes -= d->size;
+    if (!d->node) stats.negative--;
+    
+    /* Drop the pins (may release the nodes from the inode cache) */
+    if (d->node) vfs_node_put(d->node);
+    vfs_node_put(d->parent);
+    kfree(d);
+}
+
+/**
+ * Look up a name. Returns false on a miss; on a hit *node is a new
+ * reference to the target, or NULL for a cached "doesn't exist".
+ */
+bool dcache_lookup(fs_node_t* parent, const char* name, fs_node_t** node) {
+    uint32_t hash = dentry_hash(parent, name);
+    
+    for (dentry_t* d = hash_table[hash & (DCACHE_BUCKETS - 1)]; d; d = d->hash_next) {
+        if (d->hash == hash && d->parent == parent && name_equals(d->name, name)) {
+            lru_unlink(d);
+            lru_push_front(d);
+            
+            if (d->node) {
+                stats.hits++;
+                vfs_node_get(d->node);
+            } else {
+                stats.negative_hits++;
+            }
+            *node = d->node;
+            return true;
+        }
+    }
+    
+    stats.misses++;
+    return false;
+}
+
+/**
+ * Remember a lookup result (node == NULL records a missing name).
+ * Only nodes from the inode cache can be remembered.
+ */
+void dcache_add(fs_node_t* parent, const char* name, fs_node_t* node) {
+    if (!parent->fs || (node && !node->fs)) return;
+    
+    uint32_t len = 0;
+    while (name[len]) len++;
+    
+    uint32_t size = sizeof(dentry_t) + len + 1;
+    if (size > DCACHE_MAX_BYTES) return;
+    
+    /* Make room first, oldest entries go */
+    while (stats.bytes + size > DCACHE_MAX_BYTES && lru_tail) {
+        stats.evictions++;
+        dentry_free(lru_tail);
+    }
+    
+    dentry_t* d = (dentry_t*)kmalloc(size);
+    if (!d) return;
+    
+    d->parent = parent;
+    d->node = node;
+    d->hash = dentry_hash(parent, name);
+    d->size = size;
+    kmemcpy(d->name, name, len + 1);
+    
+    vfs_node_get(parent);
+    if (node) vfs_node_get(node);
+    
+    uint32_t bucket = d->hash & (DCACHE_BUCKETS - 1);
+    d->hash_next = hash_table[bucket];
+    hash_table[bucket] = d;
+    lru_push_front(d);
+    
+    stats.entries++;
+    stats.bytes += size;
+    if (!node) stats.negative++;
+}
+
+/**
+ * Drop cached names under a directory, e.g. after a create or unlink
+ */
+void dcache_invalidate(fs_node_t* parent) {
+    dentry_t* d = lru_head;
+    while (d) {
+        dentry_t* next = d->lru_next;
+        if (!parent || d->parent == parent) dentry_free(d);
+        d = next;
+    }
+}
+
+void dcache_get_stats(dcache_stats_t* out) {
+    kmemcpy(out, &stats, sizeof(dcache_stats_t));
+}
@@ -0,0 +1,48 @@
+/**
+ * OpenWare OS - Directory Entry Cache
+ * Copyright (c) 2026 Ventryx Inc. All rights reserved.
+ *
+ * Remembers the result of (directory, name) lookups, including names
+ * that don't exist, so repeated path walks never reach the driver.
+ * Entries pin their directory and target nodes in the inode cache.
+ */
+
+#ifndef DCACHE_H
+#define DCACHE_H
+
+#include "../include/types.h"
+#include "vfs.h"
+
+#define DCACHE_BUCKETS      128         /* Must be a power of two */
+#define DCACHE_MAX_BYTES    (16 * 1024) /* Entries (names included) kept at most */
+
+typedef struct dentry {
+    struct dentry* hash_next;
+    struct dentry* lru_prev;    /* Most recently used at the head */
+    struct dentry* lru_next;
+    fs_node_t* parent;
+    fs_node_t* node;            /* NULL: negative entry, the name doesn't exist */
+    uint32_t hash;
+    uint32_t size;              /* Bytes charged against the cap */
+    char name[];
+} dentry_t;
+
+typedef struct {
+    uint32_t entries;
+    uint32_t negative;          /* Entries recording a missing name */
+    uint32_t bytes;
+    uint32_t hits;
+    uint32_t negative_hits;
+    uint32_t misses;
+    uint32_t evictions;
+} dcache_stats_t;
+
+/* True if cached; *node is then a referenced node, or NULL if the name is known missing */
+bool dcache_lookup(fs_node_t* parent, const char* name, fs_node_t** node);
+void dcache_add(fs_node_t* parent, const char* name, fs_node_t* node);
+
+/* Forget every name under a directory that changed (NULL: everything) */
+void dcache_invalidate(fs_node_t* parent);
+void dcache_get_stats(dcache_stats_t* stats);
+
+#endif
@@ -1,27 +1,324 @@
 #include "fat32.h"
-#include "../kernel/ata.h"
-#include "../kernel/ramdisk.h"
+#include "../include/blockdev.h"
+#include "../include/bcache.h"
+#include "../include/blkqueue.h"
 #include "../include/memory.h"
 #include "../kernel/vga.h"
 
+/* FAT32 entries are 28 bits; anything at or above this ends a chain */
+#define FAT32_EOC       0x0FFFFFF8
+#define FAT32_MASK      0x0FFFFFFF
+#define FAT32_EOC_MARK  0x0FFFFFFF  /* Written to end a chain */
+
+#define FAT_CACHE_SECTORS   32  /* Direct-mapped cache of FAT sectors (16KB) */
+#define FAT_ENTRIES_PER_SECTOR  128
+
+typedef struct {
+    uint32_t sector;            /* FAT-relative sector number */
+    bool valid;
+    uint32_t entries[FAT_ENTRIES_PER_SECTOR];
+} fat_cache_line_t;
+
+/* A run of physically contiguous clusters within a chain */
+typedef struct {
+    uint32_t file_cluster;      /* Index of the run's first cluster in the chain */
+    uint32_t cluster;           /* First cluster of the run on disk */
+    uint32_t count;
+} fat_extent_t;
+
+/* Extent map of a whole chain, built once per open node */
+typedef struct {
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t clusters;          /* Chain length */
+    fat_extent_t* extents;
+} fat_extent_map_t;
+
+/* One live directory entry, as found by the index */
+typedef struct fat_dir_name {
+    struct fat_dir_name* next_short;    /* Hash chains */
+    struct fat_dir_name* next_long;
+    uint32_t slot;              /* Index of the short entry in the directory */
+    uint32_t lfn_slots;         /* LFN entries right before it */
+    uint32_t cluster;
+    uint32_t size;
+    uint8_t attr;
+    char short_name[13];
+    char* long_name;            /* NULL if the entry has no LFN */
+} fat_dir_name_t;
+
+/* Hashed index of a whole directory, built on first access */
+typedef struct {
+    uint32_t count;
+    uint32_t mask;              /* Buckets - 1 */
+    fat_dir_name_t** by_short;
+    fat_dir_name_t** by_long;
+    fat_dir_name_t** order;     /* Directory order, for readdir */
+} fat_dir_index_t;
+
+#define FAT_DIR_MIN_BUCKETS 16
+
+/* Inode cache keys: directories by first cluster, files by the on-disk
+ * position of their directory entry (sector * 16 + entry) */
+#define FAT_INODE_FILE      0x80000000
+
+/* Driver state hanging off fs_node_t::impl_data */
+typedef struct {
+    fat_extent_map_t* extents;
+    fat_dir_index_t* index;     /* Directories only */
+} fat_node_t;
+
 /* Global FAT32 State */
+static blockdev_t* fat_dev;
+static bool fat_dax;            /* Device is memory: read clusters in place */
 static fat_bpb_t bpb;
 static uint32_t fat_begin_lba;
 static uint32_t cluster_begin_lba;
 static uint32_t sectors_per_cluster;
 static uint32_t root_cluster;
+static uint32_t total_clusters;
+static fat_cache_line_t* fat_cache;
+
+/* Allocation state: bit set = cluster in use (bit 0 is cluster 2) */
+static uint32_t* free_map;
+static uint32_t free_clusters;
+static uint32_t next_free;      /* Where the next search starts */
+static bool fsinfo_valid;
+
+/* FAT sectors changed by the current operation, mirrored on commit */
+#define FAT_DIRTY_MAX   16
+static uint32_t fat_dirty[FAT_DIRTY_MAX];
+static uint32_t fat_dirty_count;
 static dirent_t current_dirent;
 
 /* Forward declarations */
 static uint32_t fat32_read(fs_node_t* node, uint32_t offset, uint32_t size, uint8_t* buffer);
+static uint32_t fat32_readv(fs_node_t* node, uint32_t offset, const iovec_t* iov, uint32_t count);
+static void fat32_prefetch_range(fs_node_t* node, uint32_t offset, uint32_t size);
 static fs_node_t* fat32_finddir(fs_node_t* node, char* name);
 static dirent_t* fat32_readdir(fs_node_t* node, uint32_t index);
+static uint32_t fat32_readdir_batch(fs_node_t* node, uint32_t* pos, dirent_t* out, uint32_t max);
+static const uint8_t* fat32_map(fs_node_t* node, uint32_t offset, uint32_t size);
+static void fat32_release(fs_node_t* node);
+static uint32_t fat32_write(fs_node_t* node, uint32_t offset, uint32_t size, uint8_t* buffer);
+static fs_node_t* fat32_create(fs_node_t* dir, char* name, uint32_t type);
+static int fat32_unlink(fs_node_t* dir, char* name);
+static int fat32_truncate(fs_node_t* node, uint32_t length);
+static int fat32_build_free_map(void);
+static void fat32_commit(void);
 
-/* Helper: Read a cluster */
-static void fat32_read_cluster(uint32_t cluster, uint8_t* buffer) {
-    uint32_t lba = cluster_begin_lba + (cluster - 2) * sectors_per_cluster;
-    // Switch to Ramdisk for "One ISO" solution
-    ramdisk_read(lba, sectors_per_cluster, buffer);
+static inline uint32_t cluster_lba(uint32_t cluster) {
+    return cluster_begin_lba + (cluster - 2) * sectors_per_cluster;
+}
+
+/* Helper: Follow one link of a cluster chain (returns >= FAT32_EOC at the end) */
+static uint32_t fat32_next_cluster(uint32_t cluster) {
+    uint32_t sector = cluster / FAT_ENTRIES_PER_SECTOR;
+    uint32_t next;
+    
+    fat_cache_line_t* line = fat_cache ? &fat_cache[sector % FAT_CACHE_SECTORS] : 0;
+    if (line && line->valid && line->sector == sector) {
+        next = line->entries[cluster % FAT_ENTRIES_PER_SECTOR];
+    } else {
+        buf_t* buf = bcache_get(fat_dev, fat_begin_lba + sector);
+        if (!buf) return FAT32_EOC;
+        
+        if (line) {
+            kmemcpy(line->entries, buf->data, 512);
+            line->sector = sector;
+            line->valid = true;
+        }
+        next = ((uint32_t*)buf->data)[cluster % FAT_ENTRIES_PER_SECTOR];
+        bcache_release(buf);
+    }
+    
+    next &= FAT32_MASK;
+    /* Free/reserved entry inside a chain, or past the volume: treat as end */
+    if (next < 2 || (next < FAT32_EOC && next >= total_clusters + 2)) return FAT32_EOC;
+    return next;
+}
+
+/* Helper: Add the next cluster of a chain to its extent map */
+static bool fat32_extents_append(fat_extent_map_t* map, uint32_t cluster) {
+    fat_extent_t* last = map->count ? &map->extents[map->count - 1] : 0;
+    
+    if (last && cluster == last->cluster + last->count) {
+        last->count++;
+    } else {
+        if (map->count == map->capacity) {
+            uint32_t capacity = map->capacity ? map->capacity * 2 : 4;
+            fat_extent_t* grown = (fat_extent_t*)kmalloc(capacity * sizeof(fat_extent_t));
+            if (!grown) return false;
+            if (map->extents) {
+                kmemcpy(grown, map->extents, map->count * sizeof(fat_extent_t));
+                kfree(map->extents);
+            }
+            map->extents = grown;
+            map->capacity = capacity;
+        }
+        map->extents[map->count].file_cluster = map->clusters;
+        map->extents[map->count].cluster = cluster;
+        map->extents[map->count].count = 1;
+        map->count++;
+    }
+    
+    map->clusters++;
+    return true;
+}
+
+/* Helper: Walk a chain once and record its contiguous runs */
+static fat_extent_map_t* fat32_build_extents(uint32_t cluster) {
+    fat_extent_map_t* map = (fat_extent_map_t*)kcalloc(1, sizeof(fat_extent_map_t));
+    if (!map) return 0;
+    
+    /* A chain can't be longer than the volume: guards against loops */
+    while (cluster >= 2 && cluster < FAT32_EOC && map->clusters < total_clusters) {
+        if (!fat32_extents_append(map, cluster)) break;
+        cluster = fat32_next_cluster(cluster);
+    }
+    return map;
+}
+
+static void fat32_free_extents(fat_extent_map_t* map) {
+    if (!map) return;
+    kfree(map->extents);
+    kfree(map);
+}
+
+/* Helper: Driver state of a node, allocated on first use */
+static fat_node_t* fat32_node(fs_node_t* node) {
+    if (!node->impl_data) node->impl_data = kcalloc(1, sizeof(fat_node_t));
+    return (fat_node_t*)node->impl_data;
+}
+
+/* Helper: Extent map of a node, built on first use */
+static fat_extent_map_t* fat32_extents(fs_node_t* node) {
+    fat_node_t* fn = fat32_node(node);
+    if (!fn) return 0;
+    if (!fn->extents) fn->extents = fat32_build_extents(node->impl);
+    return fn->extents;
+}
+
+/* Helper: Binary search for the run holding chain cluster 'index' */
+static fat_extent_t* fat32_find_extent(fat_extent_map_t* map, uint32_t index) {
+    if (index >= map->clusters) return 0;
+    
+    uint32_t lo = 0;
+    uint32_t hi = map->count;
+    while (hi - lo > 1) {
+        uint32_t mid = (lo + hi) / 2;
+        if (map->extents[mid].file_cluster <= index) lo = mid;
+        else hi = mid;
+    }
+    return &map->extents[lo];
+}
+
+/* Helper: LBA holding byte 'offset' of a chain (0 past the end) */
+static uint32_t fat32_offset_lba(fat_extent_map_t* map, uint32_t offset) {
+    uint32_t cluster_size = sectors_per_cluster * 512;
+    fat_extent_t* ext = fat32_find_extent(map, offset / cluster_size);
+    if (!ext) return 0;
+    return cluster_lba(ext->cluster) + (offset - ext->file_cluster * cluster_size) / 512;
+}
+
+/* Helper: Copy 'size' bytes starting 'skip' bytes into sector 'lba' of a
+ * contiguous run. Whole sectors go through one multi-sector cache read,
+ * so misses reach the device as a single request. */
+static int fat32_read_run(uint32_t lba, uint32_t skip, uint32_t size, uint8_t* buffer) {
+    if (fat_dax) {
+        uint32_t sectors = (skip + size + 511) / 512;
+        uint8_t* direct = blockdev_direct_access(fat_dev, lba, sectors);
+        
+        /* Copying in place bypasses the cache: pending writes there go first */
+        if (direct && bcache_sync_range(fat_dev, lba, sectors) == 0) {
+            kmemcpy(buffer, direct + skip, size);
+            return 0;
+        }
+    }
+    
+    while (size > 0) {
+        if (skip == 0 && size >= 512) {
+            uint32_t sectors = size / 512;
+            if (bcache_read(fat_dev, lba, sectors, buffer) != 0) return -1;
+            lba += sectors;
+            buffer += sectors * 512;
+            size -= sectors * 512;
+            continue;
+        }
+        
+        /* Partial sector at either end */
+        buf_t* buf = bcache_get(fat_dev, lba);
+        if (!buf) return -1;
+        
+        uint32_t chunk = 512 - skip;
+        if (chunk > size) chunk = size;
+        kmemcpy(buffer, buf->data + skip, chunk);
+        bcache_release(buf);
+        
+        lba++;
+        skip = 0;
+        buffer += chunk;
+        size -= chunk;
+    }
+    return 0;
+}
+
+/* Helper: Queue chain clusters [first, first + count) for reading, without waiting */
+static void fat32_prefetch(fat_extent_map_t* map, uint32_t first, uint32_t count) {
+    blkq_plug(fat_dev);
+    while (count > 0) {
+        fat_extent_t* ext = fat32_find_extent(map, first);
+        if (!ext) break;
+        
+        uint32_t in_run = first - ext->file_cluster;
+        uint32_t n = ext->count - in_run;
+        if (n > count) n = count;
+        
+        bcache_prefetch(fat_dev, cluster_lba(ext->cluster + in_run), n * sectors_per_cluster);
+        first += n;
+        count -= n;
+    }
+    blkq_unplug_deferred(fat_dev);
+}
+
+/* Directory walk over the whole cluster chain, one raw entry at a time */
+typedef struct {
+    fat_extent_map_t* map;
+    uint32_t slot;              /* Next entry index within the chain */
+    uint32_t buf_lba;
+    buf_t* buf;
+} fat_dir_iter_t;
+
+static bool fat32_dir_begin(fat_dir_iter_t* it, fs_node_t* dir) {
+    it->map = fat32_extents(dir);
+    it->slot = 0;
+    it->buf_lba = 0;
+    it->buf = 0;
+    return it->map != 0;
+}
+
+/* Returns the next entry, or NULL at the end marker / end of the chain */
+static fat_dir_entry_t* fat32_dir_next(fat_dir_iter_t* it) {
+    uint32_t offset = it->slot * sizeof(fat_dir_entry_t);
+    uint32_t lba = fat32_offset_lba(it->map, offset);
+    if (!lba) return 0;
+    
+    if (!it->buf || it->buf_lba != lba) {
+        if (it->buf) bcache_release(it->buf);
+        it->buf = bcache_get(fat_dev, lba);
+        it->buf_lba = lba;
+        if (!it->buf) return 0;
+    }
+    
+    fat_dir_entry_t* entry = (fat_dir_entry_t*)(it->buf->data + offset % 512);
+    if (entry->name[0] == 0x00) return 0;   /* End of directory */
+    it->slot++;
+    return entry;
+}
+
+static void fat32_dir_end(fat_dir_iter_t* it) {
+    if (it->buf) bcache_release(it->buf);
+    it->buf = 0;
 }
 
 /* Helper: Convert filename 8.3 to normal string */
@@ -38,146 +335,1187 @@ static void fat_to_str(char* dest, char* src) {
     dest[i] = 0;
 }
 
-/* Initialize FAT32 */
-void fat32_init(void) {
-    uint8_t* buffer = kmalloc(512);
+/* Names compare case-insensitively, like FAT itself */
+static inline char fold_case(char c) {
+    return (c >= 'a' && c <= 'z') ? c - 'a' + 'A' : c;
+}
+
+static uint32_t name_hash(const char* name) {
+    uint32_t h = 2166136261u;   /* FNV-1a */
+    while (*name) {
+        h ^= (uint8_t)fold_case(*name++);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static bool name_equals(const char* a, const char* b) {
+    while (*a && fold_case(*a) == fold_case(*b)) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+/* Helper: Checksum of an 11-byte short name, stored in its LFN entries */
+static uint8_t lfn_checksum(const char* short_name) {
+    uint8_t sum = 0;
+    for (int i = 0; i < 11; i++) {
+        sum = (uint8_t)(((sum & 1) << 7) + (sum >> 1) + (uint8_t)short_name[i]);
+    }
+    return sum;
+}
+
+/* Helper: Copy the 13 characters of one LFN entry into place (ASCII only) */
+static void lfn_collect(char* lfn, fat_lfn_entry_t* entry) {
+    uint32_t base = ((entry->order & 0x1F) - 1) * FAT_LFN_CHARS;
+    uint16_t chars[FAT_LFN_CHARS];
     
-    /* Read Boot Sector from Ramdisk */
-    ramdisk_read(0, 1, buffer);
+    kmemcpy(chars, entry->name1, sizeof(entry->name1));
+    kmemcpy(chars + 5, entry->name2, sizeof(entry->name2));
+    kmemcpy(chars + 11, entry->name3, sizeof(entry->name3));
+    
+    for (int i = 0; i < FAT_LFN_CHARS && base + i < FAT_LFN_MAX; i++) {
+        uint16_t c = chars[i];
+        if (c == 0x0000 || c == 0xFFFF) c = 0;
+        else if (c > 0x7E) c = '?';
+        lfn[base + i] = (char)c;
+    }
+}
+
+static void fat32_free_index(fat_dir_index_t* index) {
+    if (!index) return;
+    for (uint32_t i = 0; i < index->count; i++) kfree(index->order[i]);
+    kfree(index->order);
+    kfree(index->by_short);
+    kfree(index->by_long);
+    kfree(index);
+}
+
+/* Helper: Walk the whole directory chain once and hash every live name */
+static fat_dir_index_t* fat32_build_index(fs_node_t* dir) {
+    fat_dir_index_t* index = (fat_dir_index_t*)kcalloc(1, sizeof(fat_dir_index_t));
+    if (!index) return 0;
+    
+    fat_dir_iter_t it;
+    if (!fat32_dir_begin(&it, dir)) {
+        kfree(index);
+        return 0;
+    }
+    
+    char lfn[FAT_LFN_MAX + 1];
+    int lfn_next = 0;           /* Sequence number expected next, 0: none pending */
+    int lfn_parts = 0;
+    uint8_t lfn_sum = 0;
+    uint32_t capacity = 0;
+    bool failed = false;
+    fat_dir_entry_t* entry;
+    
+    while ((entry = fat32_dir_next(&it)) != 0) {
+        if ((uint8_t)entry->name[0] == 0xE5) { /* Deleted */
+            lfn_next = 0;
+            lfn[0] = 0;
+            continue;
+        }
+        
+        if (entry->attr == FAT_ATTR_LFN) {
+            fat_lfn_entry_t* part = (fat_lfn_entry_t*)entry;
+            int order = part->order & 0x1F;
+            
+            if (part->order & FAT_LFN_LAST) {
+                kmemset(lfn, 0, sizeof(lfn));
+                lfn_sum = part->checksum;
+                lfn_parts = order;
+            } else if (order != lfn_next || part->checksum != lfn_sum) {
+                order = 0;      /* Orphaned part */
+            }
+            if (order == 0) {
+                lfn_next = 0;
+                lfn[0] = 0;
+                continue;
+            }
+            lfn_collect(lfn, part);
+            lfn_next = order - 1;
+            continue;
+        }
+        
+        /* A long name only belongs to the short entry right after its part 1 */
+        bool has_lfn = lfn_next == 0 && lfn[0] && lfn_sum == lfn_checksum(entry->name);
+        if (entry->attr & FAT_ATTR_VOLUME_ID) {
+            lfn[0] = 0;
+            continue;
+        }
+        
+        uint32_t lfn_len = 0;
+        if (has_lfn) while (lfn[lfn_len]) lfn_len++;
+        
+        fat_dir_name_t* rec = (fat_dir_name_t*)kmalloc(sizeof(fat_dir_name_t) + (has_lfn ? lfn_len + 1 : 0));
+        if (index->count == capacity) {
+            uint32_t grown_capacity = capacity ? capacity * 2 : 32;
+            fat_dir_name_t** grown = (fat_dir_name_t**)kmalloc(grown_capacity * sizeof(fat_dir_name_t*));
+            if (grown && index->order) {
+                kmemcpy(grown, index->order, index->count * sizeof(fat_dir_name_t*));
+            }
+            if (grown) {
+                kfree(index->order);
+                index->order = grown;
+                capacity = grown_capacity;
+            }
+        }
+        if (!rec || index->count == capacity) {
+            kfree(rec);
+            failed = true;
+            break;
+        }
+        
+        rec->slot = it.slot - 1;
+        rec->cluster = ((uint32_t)entry->first_cluster_hi << 16) | entry->first_cluster_lo;
+        rec->size = entry->size;
+        rec->attr = entry->attr;
+        fat_to_str(rec->short_name, entry->name);
+        rec->long_name = 0;
+        rec->lfn_slots = has_lfn ? lfn_parts : 0;
+        if (has_lfn) {
+            rec->long_name = (char*)(rec + 1);
+            kmemcpy(rec->long_name, lfn, lfn_len + 1);
+        }
+        index->order[index->count++] = rec;
+        lfn[0] = 0;
+    }
+    fat32_dir_end(&it);
+    
+    /* Size the tables for the final count: about one name per bucket */
+    uint32_t buckets = FAT_DIR_MIN_BUCKETS;
+    while (buckets < index->count) buckets *= 2;
+    index->mask = buckets - 1;
+    index->by_short = (fat_dir_name_t**)kcalloc(buckets, sizeof(fat_dir_name_t*));
+    index->by_long = (fat_dir_name_t**)kcalloc(buckets, sizeof(fat_dir_name_t*));
+    
+    if (failed || !index->by_short || !index->by_long) {
+        fat32_free_index(index);
+        return 0;
+    }
+    
+    for (uint32_t i = 0; i < index->count; i++) {
+        fat_dir_name_t* rec = index->order[i];
+        uint32_t h = name_hash(rec->short_name) & index->mask;
+        rec->next_short = index->by_short[h];
+        index->by_short[h] = rec;
+        
+        rec->next_long = 0;
+        if (rec->long_name) {
+            h = name_hash(rec->long_name) & index->mask;
+            rec->next_long = index->by_long[h];
+            index->by_long[h] = rec;
+        }
+    }
+    return index;
+}
+
+/* Helper: Name index of a directory node, built on first use */
+static fat_dir_index_t* fat32_dir_index(fs_node_t* dir) {
+    fat_node_t* fn = fat32_node(dir);
+    if (!fn) return 0;
+    if (!fn->index) fn->index = fat32_build_index(dir);
+    return fn->index;
+}
+
+/* Helper: Forget the index (and layout) of a directory that changed */
+static void fat32_dir_invalidate(fs_node_t* dir) {
+    fat_node_t* fn = (fat_node_t*)dir->impl_data;
+    if (!fn) return;
+    fat32_free_index(fn->index);
+    fat32_free_extents(fn->extents);
+    fn->index = 0;
+    fn->extents = 0;
+}
+
+/* Helper: Find a name (long or 8.3) in the index */
+static fat_dir_name_t* fat32_index_lookup(fat_dir_index_t* index, const char* name) {
+    uint32_t h = name_hash(name) & index->mask;
+    
+    for (fat_dir_name_t* rec = index->by_long[h]; rec; rec = rec->next_long) {
+        if (name_equals(rec->long_name, name)) return rec;
+    }
+    for (fat_dir_name_t* rec = index->by_short[h]; rec; rec = rec->next_short) {
+        if (name_equals(rec->short_name, name)) return rec;
+    }
+    return 0;
+}
+
+/* Mount the FAT32 volume on the given block device */
+int fat32_init(blockdev_t* dev) {
+    if (!dev) return -1;
+    
+    uint8_t* buffer = kmalloc(dev->sector_size);
+    if (!buffer) return -1;
+    
+    /* Read Boot Sector */
+    if (blockdev_read(dev, 0, 1, buffer) != 0) {
+        kfree(buffer);
+        return -1;
+    }
     
     kmemcpy(&bpb, buffer, sizeof(fat_bpb_t));
     kfree(buffer);
     
-    /* Verify Signature */
-    if (bpb.boot_signature != 0x29 && bpb.boot_signature != 0x28) {
-        vga_puts("[FAT32] Checking Ramdisk... "); 
-        // If signature fails, we might warn, but proceed if it looks partially valid
+    /* Only real FAT32 volumes: the writer would corrupt FAT12/16 ones */
+    uint32_t data_lba = bpb.reserved_sectors + bpb.fats_count * bpb.sectors_per_fat_32;
+    uint32_t total_sectors = bpb.total_sectors_32 ? bpb.total_sectors_32 : bpb.total_sectors_16;
+    if (total_sectors > dev->sector_count) total_sectors = dev->sector_count;
+    uint32_t clusters = bpb.sectors_per_cluster && total_sectors > data_lba ?
+                        (total_sectors - data_lba) / bpb.sectors_per_cluster : 0;
+    
+    if ((bpb.boot_signature != 0x29 && bpb.boot_signature != 0x28) ||
+        bpb.bytes_per_sector != dev->sector_size || bpb.sectors_per_cluster == 0 ||
+        bpb.fats_count == 0 || bpb.sectors_per_fat_32 == 0 ||
+        clusters < FAT32_MIN_CLUSTERS ||
+        bpb.root_cluster < 2 || bpb.root_cluster >= clusters + 2) {
+        vga_puts("[FAT32] ");
+        vga_puts(dev->name);
+        vga_puts(": not a FAT32 volume\n");
+        return -1;
     }
     
+    fat_dev = dev;
+    fat_dax = blockdev_direct_access(dev, 0, 1) != NULL;
+    
     /* Calculate Offsets */
     fat_begin_lba = bpb.reserved_sectors;
-    cluster_begin_lba = bpb.reserved_sectors + (bpb.fats_count * bpb.sectors_per_fat_32);
+    cluster_begin_lba = data_lba;
     sectors_per_cluster = bpb.sectors_per_cluster;
     root_cluster = bpb.root_cluster;
+    total_clusters = clusters;
+    
+    /* FAT sector cache (chains still work through bcache without it) */
+    if (!fat_cache) fat_cache = (fat_cache_line_t*)kmalloc(FAT_CACHE_SECTORS * sizeof(fat_cache_line_t));
+    if (fat_cache) {
+        for (int i = 0; i < FAT_CACHE_SECTORS; i++) fat_cache[i].valid = false;
+    }
+    
+    /* Free space: the bitmap is authoritative, FSInfo only seeds the hint */
+    next_free = 2;
+    fsinfo_valid = false;
+    buf_t* info = bpb.fs_info_sector ? bcache_get(fat_dev, bpb.fs_info_sector) : 0;
+    if (info) {
+        fat_fsinfo_t* fsinfo = (fat_fsinfo_t*)info->data;
+        fsinfo_valid = fsinfo->lead_signature == FAT_FSINFO_LEAD &&
+                       fsinfo->struct_signature == FAT_FSINFO_STRUCT &&
+                       fsinfo->trail_signature == FAT_FSINFO_TRAIL;
+        if (fsinfo_valid && fsinfo->next_free >= 2 && fsinfo->next_free < total_clusters + 2) {
+            next_free = fsinfo->next_free;
+        }
+        bcache_release(info);
+    }
+    
+    /* Without a bitmap the volume is still readable, just not writable */
+    bool writable = fat32_build_free_map() == 0;
     
     /* Setup Root Node */
-    fs_root = (fs_node_t*)kmalloc(sizeof(fs_node_t));
-    kmemset(fs_root, 0, sizeof(fs_node_t));
+    fs_node_t* root = (fs_node_t*)kmalloc(sizeof(fs_node_t));
+    if (!root) return -1;
+    kmemset(root, 0, sizeof(fs_node_t));
     
     // Copy name "ROOT"
-    fs_root->name[0] = '/'; fs_root->name[1] = 0;
-    fs_root->flags = FS_DIRECTORY;
-    fs_root->impl = root_cluster; /* Store start cluster in 'impl' */
-    fs_root->read = 0;
-    fs_root->write = 0;
-    fs_root->open = 0;
-    fs_root->close = 0;
-    fs_root->readdir = fat32_readdir;
-    fs_root->finddir = fat32_finddir;
+    root->name[0] = '/'; root->name[1] = 0;
+    root->flags = FS_DIRECTORY;
+    root->impl = root_cluster; /* Store start cluster in 'impl' */
+    root->inode = root_cluster;
+    root->fs = fat_dev;
+    root->read = 0;
+    root->write = 0;
+    root->open = 0;
+    root->close = 0;
+    root->readdir = fat32_readdir;
+    root->readdir_batch = fat32_readdir_batch;
+    root->finddir = fat32_finddir;
+    root->release = fat32_release;
+    root->create = writable ? fat32_create : 0;
+    root->unlink = writable ? fat32_unlink : 0;
+    
+    /* Mount as "/"; the mount holds the reference from then on */
+    vfs_icache_add(root);
+    vfs_mount("/", root);
+    vfs_node_put(root);
+    
+    return 0;
+}
+
+/* Helper: Copy an index record out as a dirent (long name when there is one) */
+static void fat32_fill_dirent(fat_dir_name_t* rec, dirent_t* out) {
+    const char* name = rec->long_name ? rec->long_name : rec->short_name;
+    
+    uint32_t i;
+    for (i = 0; name[i] && i < sizeof(out->name) - 1; i++) out->name[i] = name[i];
+    out->name[i] = 0;
+    out->inode = rec->slot;
+    out->type = (rec->attr & FAT_ATTR_DIRECTORY) ? FS_DIRECTORY : FS_FILE;
 }
 
 /* Read Directory Entry at Index */
 static dirent_t* fat32_readdir(fs_node_t* node, uint32_t index) {
     if ((node->flags & 0x7) != FS_DIRECTORY) return 0;
     
-    uint32_t cluster = node->impl;
-    uint32_t cluster_size = sectors_per_cluster * 512;
-    uint8_t* buffer = kmalloc(cluster_size);
+    fat_dir_index_t* dir = fat32_dir_index(node);
+    if (!dir || index >= dir->count) return 0;
     
-    /* Read Directory Cluster */
-    fat32_read_cluster(cluster, buffer);
+    fat32_fill_dirent(dir->order[index], &current_dirent);
+    return &current_dirent;
+}
+
+/* Read a run of entries in directory order; *pos is an index into it */
+static uint32_t fat32_readdir_batch(fs_node_t* node, uint32_t* pos, dirent_t* out, uint32_t max) {
+    if ((node->flags & 0x7) != FS_DIRECTORY) return 0;
     
-    fat_dir_entry_t* entry = (fat_dir_entry_t*)buffer;
-    int entries_count = cluster_size / sizeof(fat_dir_entry_t);
-    uint32_t valid_idx = 0;
+    fat_dir_index_t* dir = fat32_dir_index(node);
+    if (!dir) return 0;
     
-    for (int i = 0; i < entries_count; i++) {
-        if (entry[i].name[0] == 0x00) break; /* End of directory */
-        if (entry[i].name[0] == 0xE5) continue; /* Deleted */
-        
-        // Skip Long File Name (LFN) entries for now (attr == 0x0F)
-        if (entry[i].attr == FAT_ATTR_LFN) continue;
+    uint32_t count = 0;
+    while (count < max && *pos < dir->count) {
+        fat32_fill_dirent(dir->order[*pos], &out[count++]);
+        (*pos)++;
+    }
+    return count;
+}
 
-        if (valid_idx == index) {
-            fat_to_str(current_dirent.name, entry[i].name);
-            current_dirent.inode = i;
-            kfree(buffer);
-            return &current_dirent;
+/* Find file in directory (8.3 or long name, any case).
+ * Returns a referenced node from the inode cache. */
+static fs_node_t* fat32_finddir(fs_node_t* node, char* name) {
+    if ((node->flags & 0x7) != FS_DIRECTORY) return 0;
+    
+    fat_dir_index_t* dir = fat32_dir_index(node);
+    if (!dir) return 0;
+    
+    fat_dir_name_t* rec = fat32_index_lookup(dir, name);
+    if (!rec) return 0;
+    
+    /* Same file or directory as an earlier lookup: share its node */
+    uint32_t key;
+    uint32_t cluster = rec->cluster;
+    bool is_dir = (rec->attr & FAT_ATTR_DIRECTORY) != 0;
+    if (is_dir) {
+        if (cluster == 0) cluster = root_cluster; /* ".." of a top-level dir */
+        key = cluster;
+    } else {
+        fat_extent_map_t* map = fat32_extents(node);
+        if (!map) return 0;
+        uint32_t lba = fat32_offset_lba(map, rec->slot * sizeof(fat_dir_entry_t));
+        key = FAT_INODE_FILE | (lba * 16 + rec->slot % 16);
+    }
+    
+    fs_node_t* file_node = vfs_icache_get(fat_dev, key);
+    if (file_node) return file_node;
+    
+    file_node = (fs_node_t*)kmalloc(sizeof(fs_node_t));
+    if (!file_node) return 0;
+    kmemset(file_node, 0, sizeof(fs_node_t));
+    
+    const char* display = rec->long_name ? rec->long_name : rec->short_name;
+    for (uint32_t i = 0; display[i] && i < sizeof(file_node->name) - 1; i++) file_node->name[i] = display[i];
+    file_node->inode = key;
+    file_node->fs = fat_dev;
+    file_node->length = rec->size;
+    file_node->impl = cluster;
+    file_node->flags = is_dir ? FS_DIRECTORY : FS_FILE;
+    if (fat_dax && !is_dir) file_node->flags |= FS_NOCACHE;    /* Read in place, like tmpfs */
+    readahead_init(&file_node->ra);
+    
+    file_node->read = fat32_read;
+    if (!is_dir) {
+        file_node->readv = fat32_readv;
+        file_node->prefetch = fat32_prefetch_range;
+    }
+    file_node->map = fat32_map;
+    file_node->readdir = fat32_readdir;
+    file_node->readdir_batch = fat32_readdir_batch;
+    file_node->finddir = fat32_finddir;
+    file_node->release = fat32_release;
+    if (free_map) {
+        if (is_dir) {
+            file_node->create = fat32_create;
+            file_node->unlink = fat32_unlink;
+        } else {
+            file_node->write = fat32_write;
+            file_node->truncate = fat32_truncate;
         }
-        valid_idx++;
     }
     
-    kfree(buffer);
-    return 0;
+    vfs_icache_add(file_node);
+    return file_node;
 }
 
-/* Find file in directory */
-static fs_node_t* fat32_finddir(fs_node_t* node, char* name) {
-    if ((node->flags & 0x7) != FS_DIRECTORY) return 0;
+/* Helper: Copy file bytes [offset, offset + size) out, one copy per
+ * contiguous run of clusters. Returns the bytes copied. */
+static uint32_t fat32_copy_out(fat_extent_map_t* map, uint32_t offset, uint32_t size, uint8_t* buffer) {
+    uint32_t cluster_size = sectors_per_cluster * 512;
     
-    uint32_t cluster = node->impl;
+    uint32_t done = 0;
+    while (done < size) {
+        uint32_t pos = offset + done;
+        fat_extent_t* ext = fat32_find_extent(map, pos / cluster_size);
+        if (!ext) break;
+        
+        uint32_t in_run = pos - ext->file_cluster * cluster_size;
+        uint32_t chunk = ext->count * cluster_size - in_run;
+        if (chunk > size - done) chunk = size - done;
+        
+        if (fat32_read_run(cluster_lba(ext->cluster) + in_run / 512, in_run % 512,
+                           chunk, buffer + done) != 0) break;
+        done += chunk;
+    }
+    return done;
+}
+
+/* Helper: Note an access to [offset, offset + size) before copying it.
+ * Returns the read-ahead window to start afterwards in *ra_start and *ra_count. */
+static void fat32_begin_read(fs_node_t* node, uint32_t offset, uint32_t size,
+                             uint32_t* ra_start, uint32_t* ra_count) {
     uint32_t cluster_size = sectors_per_cluster * 512;
-    uint8_t* buffer = kmalloc(cluster_size);
+    uint32_t first = offset / cluster_size;
+    uint32_t last = (offset + size - 1) / cluster_size;
+    
+    /* Start prefetching what a sequential reader will want next
+     * (pointless when the device is memory) */
+    *ra_start = 0;
+    *ra_count = 0;
+    if (!fat_dax) {
+        uint32_t clusters = (node->length + cluster_size - 1) / cluster_size;
+        *ra_count = readahead_access(&node->ra, first, last, clusters, ra_start);
+    }
+}
+
+/* Read file content */
+static uint32_t fat32_read(fs_node_t* node, uint32_t offset, uint32_t size, uint8_t* buffer) {
+    if (offset >= node->length || size == 0) return 0;
+    if (size > node->length - offset) size = node->length - offset;
+    
+    fat_extent_map_t* map = fat32_extents(node);
+    if (!map) return 0;
     
-    /* Read Directory Cluster */
-    /* TODO: Follow cluster chain if directory spans multiple clusters */
-    fat32_read_cluster(cluster, buffer);
+    uint32_t ra_start, ra_count;
+    fat32_begin_read(node, offset, size, &ra_start, &ra_count);
     
-    fat_dir_entry_t* entry = (fat_dir_entry_t*)buffer;
-    int entries_count = cluster_size / sizeof(fat_dir_entry_t);
+    uint32_t done = fat32_copy_out(map, offset, size, buffer);
+    
+    if (ra_count > 0) fat32_prefetch(map, ra_start, ra_count);
+    
+    return done;
+}
+
+/* Scatter read. The whole span is requested from the device up front as
+ * one plugged batch, so the segments cost one merged transfer rather
+ * than one per buffer. */
+static uint32_t fat32_readv(fs_node_t* node, uint32_t offset, const iovec_t* iov, uint32_t count) {
+    uint32_t cluster_size = sectors_per_cluster * 512;
+    
+    uint32_t size = 0;
+    for (uint32_t i = 0; i < count; i++) size += iov[i].len;
+    
+    if (offset >= node->length || size == 0) return 0;
+    if (size > node->length - offset) size = node->length - offset;
+    
+    fat_extent_map_t* map = fat32_extents(node);
+    if (!map) return 0;
+    
+    uint32_t ra_start, ra_count;
+    fat32_begin_read(node, offset, size, &ra_start, &ra_count);
+    
+    if (!fat_dax) {
+        uint32_t first = offset / cluster_size;
+        fat32_prefetch(map, first, (offset + size - 1) / cluster_size - first + 1);
+    }
     
-    for (int i = 0; i < entries_count; i++) {
-        if (entry[i].name[0] == 0x00) break; /* End of directory */
-        if (entry[i].name[0] == 0xE5) continue; /* Deleted */
+    uint32_t done = 0;
+    for (uint32_t i = 0; i < count && done < size; i++) {
+        uint32_t len = iov[i].len;
+        if (len > size - done) len = size - done;
         
-        char filename[13];
-        fat_to_str(filename, entry[i].name);
+        uint32_t n = fat32_copy_out(map, offset + done, len, iov[i].base);
+        done += n;
+        if (n < len) break;
+    }
+    
+    if (ra_count > 0) fat32_prefetch(map, ra_start, ra_count);
+    
+    return done;
+}
+
+/* Start bringing [offset, offset + size) into the buffer cache */
+static void fat32_prefetch_range(fs_node_t* node, uint32_t offset, uint32_t size) {
+    uint32_t cluster_size = sectors_per_cluster * 512;
+    
+    if (fat_dax || offset >= node->length || size == 0) return;
+    if (size > node->length - offset) size = node->length - offset;
+    
+    fat_extent_map_t* map = fat32_extents(node);
+    if (!map) return;
+    
+    uint32_t first = offset / cluster_size;
+    fat32_prefetch(map, first, (offset + size - 1) / cluster_size - first + 1);
+}
+
+/* Map file content in place (DAX). Only works when the requested range
+ * lies in physically contiguous clusters. */
+static const uint8_t* fat32_map(fs_node_t* node, uint32_t offset, uint32_t size) {
+    uint32_t cluster_size = sectors_per_cluster * 512;
+    
+    if (!fat_dax || size == 0 || offset >= node->length) return 0;
+    if (size > node->length - offset) return 0;
+    
+    fat_extent_map_t* map = fat32_extents(node);
+    if (!map) return 0;
+    
+    uint32_t first = offset / cluster_size;
+    uint32_t last = (offset + size - 1) / cluster_size;
+    
+    /* The whole range must sit in one run */
+    fat_extent_t* ext = fat32_find_extent(map, first);
+    if (!ext || last >= ext->file_cluster + ext->count) return 0;
+    
+    uint32_t lba = cluster_lba(ext->cluster + (first - ext->file_cluster));
+    uint32_t sectors = (last - first + 1) * sectors_per_cluster;
+    uint8_t* base = blockdev_direct_access(fat_dev, lba, sectors);
+    if (!base) return 0;
+    
+    /* The mapping shows device contents, so nothing may be pending in the cache */
+    if (bcache_sync_range(fat_dev, lba, sectors) != 0) return 0;
+    return base + offset % cluster_size;
+}
+
+/* Node is leaving the inode cache: free extent map and index */
+static void fat32_release(fs_node_t* node) {
+    fat32_dir_invalidate(node);
+    kfree(node->impl_data);
+    node->impl_data = 0;
+}
+
+/* ------------------------------------------------------------------------
+ * Write support
+ * ------------------------------------------------------------------------ */
+
+static inline bool cluster_in_use(uint32_t cluster) {
+    uint32_t bit = cluster - 2;
+    return (free_map[bit / 32] >> (bit % 32)) & 1;
+}
+
+static inline void mark_cluster(uint32_t cluster, bool used) {
+    uint32_t bit = cluster - 2;
+    if (used) free_map[bit / 32] |= 1u << (bit % 32);
+    else free_map[bit / 32] &= ~(1u << (bit % 32));
+}
+
+/* Build the free-cluster bitmap with one pass over the FAT */
+static int fat32_build_free_map(void) {
+    uint32_t words = (total_clusters + 31) / 32;
+    
+    kfree(free_map);
+    free_map = (uint32_t*)kcalloc(words, sizeof(uint32_t));
+    if (!free_map) return -1;
+    
+    /* Bits past the last cluster stay "used" so searches never return them */
+    for (uint32_t bit = total_clusters; bit < words * 32; bit++) {
+        free_map[bit / 32] |= 1u << (bit % 32);
+    }
+    
+    free_clusters = 0;
+    uint32_t sectors = (total_clusters + 2 + FAT_ENTRIES_PER_SECTOR - 1) / FAT_ENTRIES_PER_SECTOR;
+    
+    for (uint32_t sector = 0; sector < sectors; sector++) {
+        buf_t* buf = bcache_get(fat_dev, fat_begin_lba + sector);
+        if (!buf) {
+            kfree(free_map);
+            free_map = 0;
+            return -1;
+        }
         
-        // Very simple string compare (case sensitive for now)
-        int match = 1;
-        for(int k=0; filename[k] || name[k]; k++) {
-            if(filename[k] != name[k]) { match=0; break; }
+        uint32_t* entries = (uint32_t*)buf->data;
+        for (uint32_t i = 0; i < FAT_ENTRIES_PER_SECTOR; i++) {
+            uint32_t cluster = sector * FAT_ENTRIES_PER_SECTOR + i;
+            if (cluster < 2 || cluster >= total_clusters + 2) continue;
+            if (entries[i] & FAT32_MASK) mark_cluster(cluster, true);
+            else free_clusters++;
         }
+        bcache_release(buf);
+    }
+    return 0;
+}
+
+/* Helper: First free cluster at or after 'from', wrapping around (0: full) */
+static uint32_t fat32_find_free(uint32_t from) {
+    uint32_t words = (total_clusters + 31) / 32;
+    uint32_t start = (from >= 2 && from < total_clusters + 2) ? (from - 2) / 32 : 0;
+    
+    for (uint32_t n = 0; n <= words; n++) {
+        uint32_t w = (start + n) % words;
+        uint32_t bits = free_map[w];
+        if (n == 0 && from >= 2 && from < total_clusters + 2) {
+            bits |= (1u << ((from - 2) % 32)) - 1;  /* Ignore clusters before 'from' */
+        }
+        if (bits == 0xFFFFFFFF) continue;
         
-        if (match) {
-            fs_node_t* file_node = (fs_node_t*)kmalloc(sizeof(fs_node_t));
-            kmemset(file_node, 0, sizeof(fs_node_t));
-            
-            kmemcpy(file_node->name, filename, 13);
-            file_node->inode = i; // Index in dir
-            file_node->length = entry[i].size;
-            file_node->impl = (entry[i].first_cluster_hi << 16) | entry[i].first_cluster_lo;
-            file_node->flags = FS_FILE;
-            if (entry[i].attr & FAT_ATTR_DIRECTORY) file_node->flags = FS_DIRECTORY;
-            
-            file_node->read = fat32_read;
-            file_node->finddir = fat32_finddir;
+        uint32_t bit = 0;
+        while (bits & (1u << bit)) bit++;
+        return w * 32 + bit + 2;
+    }
+    return 0;
+}
+
+/* Helper: Start of a free run of 'want' clusters, searching one lap from
+ * the hint (0 if there is none) */
+static uint32_t fat32_find_run(uint32_t want) {
+    for (int lap = 0; lap < 2; lap++) {
+        uint32_t cluster = lap ? 2 : next_free;
+        uint32_t end = lap ? next_free : total_clusters + 2;
+        
+        while (cluster < end) {
+            uint32_t start = fat32_find_free(cluster);
+            if (start < cluster || start >= end) break;     /* Wrapped or full */
             
-            kfree(buffer);
-            return file_node;
+            uint32_t run = 1;
+            while (run < want && start + run < total_clusters + 2 && !cluster_in_use(start + run)) run++;
+            if (run == want) return start;
+            cluster = start + run;
         }
     }
+    return 0;
+}
+
+/* Helper: Claim one cluster. Prefers 'goal' (the cluster after the end of
+ * the chain being grown), then a run of 'want' free clusters, then anything. */
+static uint32_t fat32_alloc_cluster(uint32_t goal, uint32_t want) {
+    if (free_clusters == 0) return 0;
     
-    kfree(buffer);
+    uint32_t cluster = 0;
+    if (goal >= 2 && goal < total_clusters + 2 && !cluster_in_use(goal)) cluster = goal;
+    if (!cluster && want > 1) cluster = fat32_find_run(want);
+    if (!cluster) cluster = fat32_find_free(next_free);
+    if (!cluster) return 0;
+    
+    mark_cluster(cluster, true);
+    free_clusters--;
+    next_free = cluster + 1;
+    return cluster;
+}
+
+/* Helper: Point a FAT entry somewhere. Changes land in the cached
+ * primary FAT sector; fat32_commit mirrors each sector once. */
+static int fat32_set_next(uint32_t cluster, uint32_t value) {
+    uint32_t sector = cluster / FAT_ENTRIES_PER_SECTOR;
+    
+    buf_t* buf = bcache_get(fat_dev, fat_begin_lba + sector);
+    if (!buf) return -1;
+    
+    uint32_t* entry = (uint32_t*)buf->data + cluster % FAT_ENTRIES_PER_SECTOR;
+    *entry = (*entry & ~FAT32_MASK) | (value & FAT32_MASK);  /* Top 4 bits are reserved */
+    bcache_mark_dirty(buf);
+    
+    fat_cache_line_t* line = fat_cache ? &fat_cache[sector % FAT_CACHE_SECTORS] : 0;
+    if (line && line->valid && line->sector == sector) {
+        line->entries[cluster % FAT_ENTRIES_PER_SECTOR] = *entry;
+    }
+    bcache_release(buf);
+    
+    for (uint32_t i = 0; i < fat_dirty_count; i++) {
+        if (fat_dirty[i] == sector) return 0;
+    }
+    if (fat_dirty_count == FAT_DIRTY_MAX) fat32_commit();
+    fat_dirty[fat_dirty_count++] = sector;
     return 0;
 }
 
-/* Read file content */
-static uint32_t fat32_read(fs_node_t* node, uint32_t offset, uint32_t size, uint8_t* buffer) {
-    uint32_t cluster = node->impl;
+/* End an operation: copy changed FAT sectors to the mirror FATs and
+ * refresh the FSInfo hints. Write-back happens later, sorted, via bcache. */
+static void fat32_commit(void) {
+    bool mirrored = !(bpb.flags & 0x80);    /* Bit 7: only one FAT active */
+    
+    for (uint32_t i = 0; i < fat_dirty_count && mirrored; i++) {
+        buf_t* primary = bcache_get(fat_dev, fat_begin_lba + fat_dirty[i]);
+        if (!primary) continue;
+        
+        for (uint32_t f = 1; f < bpb.fats_count; f++) {
+            buf_t* copy = bcache_get_noread(fat_dev, fat_begin_lba + f * bpb.sectors_per_fat_32 + fat_dirty[i]);
+            if (!copy) continue;
+            kmemcpy(copy->data, primary->data, 512);
+            bcache_mark_dirty(copy);
+            bcache_release(copy);
+        }
+        bcache_release(primary);
+    }
+    
+    if (fat_dirty_count > 0 && fsinfo_valid) {
+        buf_t* info = bcache_get(fat_dev, bpb.fs_info_sector);
+        if (info) {
+            fat_fsinfo_t* fsinfo = (fat_fsinfo_t*)info->data;
+            fsinfo->free_count = free_clusters;
+            fsinfo->next_free = next_free;
+            bcache_mark_dirty(info);
+            bcache_release(info);
+        }
+    }
+    
+    fat_dirty_count = 0;
+}
+
+/* Helper: Return a whole chain to the free pool */
+static void fat32_free_chain(uint32_t cluster) {
+    uint32_t count = 0;
+    while (cluster >= 2 && cluster < FAT32_EOC && count++ < total_clusters) {
+        uint32_t next = fat32_next_cluster(cluster);
+        if (fat32_set_next(cluster, 0) != 0) break;
+        if (cluster_in_use(cluster)) {
+            mark_cluster(cluster, false);
+            free_clusters++;
+        }
+        if (cluster < next_free) next_free = cluster;
+        cluster = next;
+    }
+}
+
+/* Helper: Fill a cluster with zeros (new directory space) */
+static int fat32_zero_cluster(uint32_t cluster) {
+    uint32_t lba = cluster_lba(cluster);
+    for (uint32_t i = 0; i < sectors_per_cluster; i++) {
+        buf_t* buf = bcache_get_noread(fat_dev, lba + i);
+        if (!buf) return -1;
+        kmemset(buf->data, 0, 512);
+        bcache_mark_dirty(buf);
+        bcache_release(buf);
+    }
+    return 0;
+}
+
+/* Helper: Grow a chain by 'count' clusters, keeping its extent map in
+ * step. Returns how many were added; node->impl is set for empty chains. */
+static uint32_t fat32_grow_chain(fs_node_t* node, fat_extent_map_t* map, uint32_t count) {
+    uint32_t prev = 0;
+    if (map->count) {
+        fat_extent_t* last = &map->extents[map->count - 1];
+        prev = last->cluster + last->count - 1;
+    }
+    
+    uint32_t added = 0;
+    while (added < count) {
+        uint32_t cluster = fat32_alloc_cluster(prev ? prev + 1 : 0, count - added);
+        if (!cluster) break;
+        
+        if (fat32_set_next(cluster, FAT32_EOC_MARK) != 0 ||
+            (prev && fat32_set_next(prev, cluster) != 0) ||
+            !fat32_extents_append(map, cluster)) {
+            mark_cluster(cluster, false);
+            free_clusters++;
+            break;
+        }
+        if (!prev) node->impl = cluster;
+        
+        prev = cluster;
+        added++;
+    }
+    return added;
+}
+
+/* Helper: Referenced buffer holding the directory entry of a file node */
+static buf_t* fat32_file_entry(fs_node_t* node, fat_dir_entry_t** entry) {
+    if (!(node->inode & FAT_INODE_FILE)) return 0;
+    
+    uint32_t position = node->inode & ~FAT_INODE_FILE;
+    buf_t* buf = bcache_get(fat_dev, position / 16);
+    if (buf) *entry = (fat_dir_entry_t*)buf->data + position % 16;
+    return buf;
+}
+
+/* Helper: Store a file's size and first cluster back in its entry */
+static int fat32_update_entry(fs_node_t* node) {
+    fat_dir_entry_t* entry;
+    buf_t* buf = fat32_file_entry(node, &entry);
+    if (!buf) return -1;
+    
+    entry->size = node->length;
+    entry->first_cluster_hi = (uint16_t)(node->impl >> 16);
+    entry->first_cluster_lo = (uint16_t)(node->impl & 0xFFFF);
+    entry->attr |= FAT_ATTR_ARCHIVE;
+    bcache_mark_dirty(buf);
+    bcache_release(buf);
+    return 0;
+}
+
+/* Helper: Copy into file bytes [offset, offset + size), allocating as
+ * needed (buffer == NULL writes zeros). Returns bytes written. */
+static uint32_t fat32_write_data(fs_node_t* node, uint32_t offset, uint32_t size, const uint8_t* buffer) {
     uint32_t cluster_size = sectors_per_cluster * 512;
-    uint8_t* cl_buffer = kmalloc(cluster_size);
+    fat_extent_map_t* map = fat32_extents(node);
+    if (!map || size == 0) return 0;
+    
+    /* Allocate the whole missing tail at once so it can be one run */
+    if (size > 0xFFFFFFFF - offset) size = 0xFFFFFFFF - offset;
+    uint32_t needed = (offset + size - 1) / cluster_size + 1;
+    if (needed > map->clusters) fat32_grow_chain(node, map, needed - map->clusters);
+    if (map->clusters * cluster_size <= offset) return 0;
+    if (size > map->clusters * cluster_size - offset) size = map->clusters * cluster_size - offset;
+    
+    uint32_t done = 0;
+    while (done < size) {
+        uint32_t pos = offset + done;
+        fat_extent_t* ext = fat32_find_extent(map, pos / cluster_size);
+        if (!ext) break;
+        
+        uint32_t in_run = pos - ext->file_cluster * cluster_size;
+        uint32_t lba = cluster_lba(ext->cluster) + in_run / 512;
+        uint32_t in_sector = in_run % 512;
+        uint32_t chunk = 512 - in_sector;
+        if (chunk > size - done) chunk = size - done;
+        
+        /* Whole sectors needn't be read first */
+        buf_t* buf = chunk == 512 ? bcache_get_noread(fat_dev, lba) : bcache_get(fat_dev, lba);
+        if (!buf) break;
+        if (buffer) kmemcpy(buf->data + in_sector, buffer + done, chunk);
+        else kmemset(buf->data + in_sector, 0, chunk);
+        bcache_mark_dirty(buf);
+        bcache_release(buf);
+        
+        done += chunk;
+    }
+    
+    if (offset + done > node->length) node->length = offset + done;
+    fat32_update_entry(node);
+    return done;
+}
+
+/* Write file content, extending it (holes read back as zeros) */
+static uint32_t fat32_write(fs_node_t* node, uint32_t offset, uint32_t size, uint8_t* buffer) {
+    if ((node->flags & 0x7) != FS_FILE || size == 0) return 0;
+    
+    /* Zero the gap first when writing past the end */
+    uint32_t done = 0;
+    uint32_t gap = offset > node->length ? offset - node->length : 0;
+    if (gap == 0 || fat32_write_data(node, node->length, gap, 0) == gap) {
+        done = fat32_write_data(node, offset, size, buffer);
+    }
+    
+    fat32_commit();
+    return done;
+}
+
+/* Shrink (freeing clusters) or zero-extend a file */
+static int fat32_truncate(fs_node_t* node, uint32_t length) {
+    uint32_t cluster_size = sectors_per_cluster * 512;
+    if ((node->flags & 0x7) != FS_FILE) return -1;
+    
+    if (length > node->length) {
+        uint32_t grow = length - node->length;
+        uint32_t done = fat32_write_data(node, node->length, grow, 0);
+        fat32_commit();
+        return done == grow ? 0 : -1;
+    }
+    
+    fat_extent_map_t* map = fat32_extents(node);
+    if (!map) return -1;
+    
+    uint32_t keep = (length + cluster_size - 1) / cluster_size;
+    if (keep < map->clusters) {
+        if (keep == 0) {
+            fat32_free_chain(node->impl);
+            node->impl = 0;
+        } else {
+            fat_extent_t* ext = fat32_find_extent(map, keep - 1);
+            uint32_t last = ext->cluster + (keep - 1 - ext->file_cluster);
+            uint32_t rest = fat32_next_cluster(last);
+            fat32_set_next(last, FAT32_EOC_MARK);
+            fat32_free_chain(rest);
+        }
+        
+        /* Rebuilt on next use */
+        fat_node_t* fn = (fat_node_t*)node->impl_data;
+        fat32_free_extents(fn->extents);
+        fn->extents = 0;
+    }
+    
+    node->length = length;
+    int result = fat32_update_entry(node);
+    fat32_commit();
+    return result;
+}
+
+/* Helper: Referenced buffer holding directory slot 'slot' (0 past the chain) */
+static buf_t* fat32_dir_slot(fat_extent_map_t* map, uint32_t slot, fat_dir_entry_t** entry) {
+    uint32_t offset = slot * sizeof(fat_dir_entry_t);
+    uint32_t lba = fat32_offset_lba(map, offset);
+    if (!lba) return 0;
+    
+    buf_t* buf = bcache_get(fat_dev, lba);
+    if (buf) *entry = (fat_dir_entry_t*)(buf->data + offset % 512);
+    return buf;
+}
+
+/* Helper: Find 'need' consecutive free slots, growing the directory if
+ * there aren't any. Returns the first slot or -1. */
+static int32_t fat32_dir_alloc_slots(fs_node_t* dir, uint32_t need) {
+    uint32_t per_cluster = sectors_per_cluster * 512 / sizeof(fat_dir_entry_t);
+    fat_extent_map_t* map = fat32_extents(dir);
+    if (!map) return -1;
+    
+    uint32_t total = map->clusters * per_cluster;
+    uint32_t run = 0;
+    for (uint32_t slot = 0; slot < total; slot++) {
+        fat_dir_entry_t* entry;
+        buf_t* buf = fat32_dir_slot(map, slot, &entry);
+        if (!buf) return -1;
+        uint8_t first = (uint8_t)entry->name[0];
+        bcache_release(buf);
+        
+        if (first == 0x00) {
+            /* End marker: everything from here on is free */
+            run += total - slot;
+            break;
+        }
+        run = first == 0xE5 ? run + 1 : 0;
+        if (run == need) return (int32_t)(slot + 1 - need);
+    }
+    
+    /* Append zeroed clusters until the trailing free run is long enough */
+    while (run < need) {
+        if (fat32_grow_chain(dir, map, 1) != 1) return -1;
+        fat_extent_t* last = &map->extents[map->count - 1];
+        if (fat32_zero_cluster(last->cluster + last->count - 1) != 0) return -1;
+        run += per_cluster;
+        total += per_cluster;
+    }
+    return (int32_t)(total - run);
+}
+
+static bool short_char_valid(char c) {
+    if ((c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9')) return true;
+    const char* extra = "!#$%&'()-@^_`{}~";
+    while (*extra) {
+        if (*extra++ == c) return true;
+    }
+    return false;
+}
+
+/* Helper: 11-byte 8.3 form of 'name'; false unless 'name' is exactly one */
+static bool fat32_short_name(const char* name, char* out) {
+    kmemset(out, ' ', 11);
+    
+    int i = 0;
+    int n = 0;
+    while (name[i] && name[i] != '.') {
+        if (n == 8 || !short_char_valid(name[i])) return false;
+        out[n++] = name[i++];
+    }
+    if (n == 0) return false;
+    
+    if (name[i] == '.') {
+        i++;
+        n = 0;
+        while (name[i]) {
+            if (n == 3 || !short_char_valid(name[i])) return false;
+            out[8 + n++] = name[i++];
+        }
+        if (n == 0) return false;
+    }
+    return true;
+}
+
+/* Helper: Unique "BASE~N.EXT" alias for a long name */
+static bool fat32_make_alias(fat_dir_index_t* index, const char* name, char* out) {
+    char base[8];
+    char ext[3];
+    int base_len = 0;
+    int ext_len = 0;
+    
+    int dot = -1;
+    for (int i = 0; name[i]; i++) {
+        if (name[i] == '.') dot = i;
+    }
+    
+    for (int i = 0; name[i] && (dot < 0 || i < dot) && base_len < 6; i++) {
+        char c = fold_case(name[i]);
+        if (c == ' ' || c == '.') continue;
+        base[base_len++] = short_char_valid(c) ? c : '_';
+    }
+    for (int i = dot + 1; dot >= 0 && name[i] && ext_len < 3; i++) {
+        char c = fold_case(name[i]);
+        if (c == ' ') continue;
+        ext[ext_len++] = short_char_valid(c) ? c : '_';
+    }
+    if (base_len == 0) base[base_len++] = '_';
+    
+    for (uint32_t number = 1; number < 1000000; number++) {
+        /* Digits of the tail, shortening the base to fit in 8 */
+        char tail[8];
+        int tail_len = 0;
+        for (uint32_t v = number; v; v /= 10) tail[tail_len++] = (char)('0' + v % 10);
+        
+        int keep = base_len;
+        if (keep > 7 - tail_len) keep = 7 - tail_len;
+        
+        kmemset(out, ' ', 11);
+        kmemcpy(out, base, keep);
+        out[keep] = '~';
+        for (int i = 0; i < tail_len; i++) out[keep + 1 + i] = tail[tail_len - 1 - i];
+        kmemcpy(out + 8, ext, ext_len);
+        
+        char candidate[13];
+        fat_to_str(candidate, out);
+        if (!fat32_index_lookup(index, candidate)) return true;
+    }
+    return false;
+}
+
+/* Helper: Write one LFN part ('part' counts from 1) */
+static void fat32_fill_lfn(fat_lfn_entry_t* entry, const char* name, uint32_t len,
+                           uint32_t part, bool last, uint8_t checksum) {
+    uint16_t chars[FAT_LFN_CHARS];
+    for (uint32_t i = 0; i < FAT_LFN_CHARS; i++) {
+        uint32_t pos = (part - 1) * FAT_LFN_CHARS + i;
+        if (pos < len) chars[i] = (uint8_t)name[pos];
+        else if (pos == len) chars[i] = 0x0000;
+        else chars[i] = 0xFFFF;
+    }
+    
+    kmemset(entry, 0, sizeof(fat_lfn_entry_t));
+    entry->order = (uint8_t)(part | (last ? FAT_LFN_LAST : 0));
+    entry->attr = FAT_ATTR_LFN;
+    entry->checksum = checksum;
+    kmemcpy(entry->name1, chars, sizeof(entry->name1));
+    kmemcpy(entry->name2, chars + 5, sizeof(entry->name2));
+    kmemcpy(entry->name3, chars + 11, sizeof(entry->name3));
+}
+
+/* Helper: Fill a short entry */
+static void fat32_fill_entry(fat_dir_entry_t* entry, const char* short_name, uint8_t attr, uint32_t cluster) {
+    kmemset(entry, 0, sizeof(fat_dir_entry_t));
+    kmemcpy(entry->name, short_name, 11);
+    entry->attr = attr;
+    entry->first_cluster_hi = (uint16_t)(cluster >> 16);
+    entry->first_cluster_lo = (uint16_t)(cluster & 0xFFFF);
+}
+
+/* Create a file or directory. Names that aren't plain upper-case 8.3 get
+ * long-name entries and a generated alias. */
+static fs_node_t* fat32_create(fs_node_t* dir, char* name, uint32_t type) {
+    if ((dir->flags & 0x7) != FS_DIRECTORY) return 0;
+    if (type != FS_FILE && type != FS_DIRECTORY) return 0;
+    
+    uint32_t len = 0;
+    while (name[len]) {
+        char c = name[len++];
+        if (c == '/' || c == '\\' || c == ':' || c == '*' || c == '?' || c == '"' ||
+            c == '<' || c == '>' || c == '|' || (uint8_t)c < 0x20) return 0;
+    }
+    if (len == 0 || len > FAT_LFN_MAX) return 0;
+    if (name[0] == '.' && (len == 1 || (len == 2 && name[1] == '.'))) return 0;
+    
+    fat_dir_index_t* index = fat32_dir_index(dir);
+    if (!index || fat32_index_lookup(index, name)) return 0;
+    
+    char short_name[11];
+    uint32_t lfn_parts = 0;
+    if (!fat32_short_name(name, short_name)) {
+        if (!fat32_make_alias(index, name, short_name)) return 0;
+        lfn_parts = (len + FAT_LFN_CHARS - 1) / FAT_LFN_CHARS;
+    }
+    
+    /* A directory starts with one zeroed cluster holding "." and ".." */
+    uint32_t cluster = 0;
+    if (type == FS_DIRECTORY) {
+        cluster = fat32_alloc_cluster(0, 1);
+        if (!cluster) return 0;
+        if (fat32_set_next(cluster, FAT32_EOC_MARK) != 0 || fat32_zero_cluster(cluster) != 0) {
+            fat32_free_chain(cluster);
+            fat32_commit();
+            return 0;
+        }
+        
+        buf_t* buf = bcache_get(fat_dev, cluster_lba(cluster));
+        if (buf) {
+            fat_dir_entry_t* dots = (fat_dir_entry_t*)buf->data;
+            fat32_fill_entry(&dots[0], ".          ", FAT_ATTR_DIRECTORY, cluster);
+            fat32_fill_entry(&dots[1], "..         ", FAT_ATTR_DIRECTORY,
+                             dir->impl == root_cluster ? 0 : dir->impl);
+            bcache_mark_dirty(buf);
+            bcache_release(buf);
+        }
+    }
     
-    /* Simple Read: Read first cluster only for now */
-    /* TODO: Follow cluster chain */
-    fat32_read_cluster(cluster, cl_buffer);
+    int32_t slot = fat32_dir_alloc_slots(dir, lfn_parts + 1);
+    fat_extent_map_t* map = fat32_extents(dir);
+    if (slot < 0 || !map) {
+        if (cluster) fat32_free_chain(cluster);
+        fat32_commit();
+        return 0;
+    }
     
-    /* Copy request size */
-    if (size > cluster_size) size = cluster_size; // Limit to one cluster for now
-    if (size > node->length) size = node->length;
+    /* Long name parts go last-first, then the short entry */
+    uint8_t checksum = lfn_checksum(short_name);
+    for (uint32_t i = 0; i <= lfn_parts; i++) {
+        fat_dir_entry_t* entry;
+        buf_t* buf = fat32_dir_slot(map, (uint32_t)slot + i, &entry);
+        if (!buf) break;
+        
+        if (i < lfn_parts) {
+            uint32_t part = lfn_parts - i;
+            fat32_fill_lfn((fat_lfn_entry_t*)entry, name, len, part, i == 0, checksum);
+        } else {
+            fat32_fill_entry(entry, short_name,
+                             type == FS_DIRECTORY ? FAT_ATTR_DIRECTORY : FAT_ATTR_ARCHIVE, cluster);
+        }
+        bcache_mark_dirty(buf);
+        bcache_release(buf);
+    }
     
-    kmemcpy(buffer, cl_buffer + offset, size);
+    fat32_commit();
+    fat32_dir_invalidate(dir);
+    return fat32_finddir(dir, name);
+}
+
+/* Delete a file, or an empty directory */
+static int fat32_unlink(fs_node_t* dir, char* name) {
+    if ((dir->flags & 0x7) != FS_DIRECTORY) return -1;
     
-    kfree(cl_buffer);
-    return size;
+    fat_dir_index_t* index = fat32_dir_index(dir);
+    if (!index) return -1;
+    
+    fat_dir_name_t* rec = fat32_index_lookup(index, name);
+    if (!rec || rec->short_name[0] == '.') return -1;
+    
+    /* Anyone still holding the node sees an empty file from now on */
+    fs_node_t* node = fat32_finddir(dir, name);
+    if (!node) return -1;
+    
+    if ((node->flags & 0x7) == FS_DIRECTORY) {
+        fat_dir_index_t* contents = fat32_dir_index(node);
+        if (!contents || contents->count > 2 || node == fs_root) {
+            vfs_node_put(node);
+            return -1;
+        }
+    }
+    
+    uint32_t cluster = rec->cluster;
+    uint32_t first_slot = rec->slot - rec->lfn_slots;
+    uint32_t last_slot = rec->slot;
+    
+    vfs_icache_forget(node);
+    fat32_dir_invalidate(node);
+    node->length = 0;
+    node->impl = 0;
+    node->write = 0;
+    node->truncate = 0;
+    node->create = 0;
+    vfs_node_put(node);
+    
+    /* Mark the short entry and its long-name parts deleted */
+    fat_extent_map_t* map = fat32_extents(dir);
+    for (uint32_t slot = first_slot; map && slot <= last_slot; slot++) {
+        fat_dir_entry_t* entry;
+        buf_t* buf = fat32_dir_slot(map, slot, &entry);
+        if (!buf) break;
+        entry->name[0] = (char)0xE5;
+        bcache_mark_dirty(buf);
+        bcache_release(buf);
+    }
+    
+    fat32_free_chain(cluster);
+    fat32_commit();
+    fat32_dir_invalidate(dir);
+    return 0;
 }
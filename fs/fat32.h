@@ -8,6 +8,7 @@
 
 #include "../include/types.h"
 #include "vfs.h"
+#include "../include/blockdev.h"
 
 /* FAT32 BPB Structure */
 #pragma pack(push, 1)
@@ -58,6 +59,29 @@ typedef struct fat_dir_entry {
     uint16_t first_cluster_lo;
     uint32_t size;
 } fat_dir_entry_t;
+
+/* FSInfo Sector (allocation hints, may be stale) */
+typedef struct fat_fsinfo {
+    uint32_t lead_signature;    /* FAT_FSINFO_LEAD */
+    uint8_t  reserved1[480];
+    uint32_t struct_signature;  /* FAT_FSINFO_STRUCT */
+    uint32_t free_count;        /* 0xFFFFFFFF: unknown */
+    uint32_t next_free;         /* 0xFFFFFFFF: unknown */
+    uint8_t  reserved2[12];
+    uint32_t trail_signature;   /* FAT_FSINFO_TRAIL */
+} fat_fsinfo_t;
+
+/* Long File Name Entry (precede their short entry, last part first) */
+typedef struct fat_lfn_entry {
+    uint8_t  order;             /* Sequence number, 0x40 marks the last part */
+    uint16_t name1[5];
+    uint8_t  attr;              /* Always FAT_ATTR_LFN */
+    uint8_t  type;
+    uint8_t  checksum;          /* Of the 11-byte short name */
+    uint16_t name2[6];
+    uint16_t first_cluster;     /* Always 0 */
+    uint16_t name3[2];
+} fat_lfn_entry_t;
 #pragma pack(pop)
 
 /* Attributes */
@@ -69,7 +93,17 @@ typedef struct fat_dir_entry {
 #define FAT_ATTR_ARCHIVE   0x20
 #define FAT_ATTR_LFN       0x0F
 
+#define FAT32_MIN_CLUSTERS 65525   /* Fewer clusters means FAT12/16 */
+
+#define FAT_FSINFO_LEAD    0x41615252
+#define FAT_FSINFO_STRUCT  0x61417272
+#define FAT_FSINFO_TRAIL   0xAA550000
+
+#define FAT_LFN_LAST       0x40
+#define FAT_LFN_CHARS      13      /* UCS-2 characters per LFN entry */
+#define FAT_LFN_MAX        255
+
 /* Driver functions */
-void fat32_init(void);
+int fat32_init(blockdev_t* dev);
 
 #endif
@@ -0,0 +1,450 @@
+/**
+ * OpenWare OS - File Page Cache
+ * Copyright (c) 2026 Ventryx Inc. All rights reserved.
+ */
+
+#include "pagecache.h"
+#include "../include/memory.h"
+
+static page_t* hash_table[PAGECACHE_BUCKETS];
+static page_t* lru_head = 0;
+static page_t* lru_tail = 0;
+static pc_file_t* files = 0;
+static pagecache_stats_t stats;
+static bool initialized = false;
+
+/* Set while calling into a filesystem: the shrinker must not pull pages
+ * (or whole files) out from under a walk in progress */
+static uint32_t busy = 0;
+
+static uint32_t page_bucket(fs_node_t* node, uint32_t index) {
+    uint32_t h = (((uint32_t)node >> 4) + index) * 0x9E3779B1;
+    return (h >> 16) & (PAGECACHE_BUCKETS - 1);
+}
+
+static void lru_unlink(page_t* page) {
+    if (page->lru_prev) page->lru_prev->lru_next = page->lru_next;
+    else lru_head = page->lru_next;
+    if (page->lru_next) page->lru_next->lru_prev = page->lru_prev;
+    else lru_tail = page->lru_prev;
+    page->lru_prev = page->lru_next = 0;
+}
+
+static void lru_push_front(page_t* page) {
+    page->lru_prev = 0;
+    page->lru_next = lru_head;
+    if (lru_head) lru_head->lru_prev = page;
+    lru_head = page;
+    if (!lru_tail) lru_tail = page;
+}
+
+static void lru_touch(page_t* page) {
+    if (lru_head == page) return;
+    lru_unlink(page);
+    lru_push_front(page);
+}
+
+static page_t* page_lookup(fs_node_t* node, uint32_t index) {
+    for (page_t* page = hash_table[page_bucket(node, index)]; page; page = page->hash_next) {
+        if (page->file->node == node && page->index == index) return page;
+    }
+    return 0;
+}
+
+/* Per-file state, created with the file's first page */
+static pc_file_t* file_get(fs_node_t* node) {
+    if (node->pages) return node->pages;
+    
+    pc_file_t* file = (pc_file_t*)kcalloc(1, sizeof(pc_file_t));
+    if (!file) return 0;
+    file->node = node;
+    file->next = files;
+    if (files) files->prev = file;
+    files = file;
+    node->pages = file;
+    stats.files++;
+    return file;
+}
+
+static void page_set_dirty(page_t* page) {
+    if (page->flags & PAGE_DIRTY) return;
+    page->flags |= PAGE_DIRTY;
+    page->file->dirty++;
+    stats.dirty++;
+}
+
+static void page_clear_dirty(page_t* page) {
+    if (!(page->flags & PAGE_DIRTY)) return;
+    page->flags &= ~PAGE_DIRTY;
+    page->file->dirty--;
+    stats.dirty--;
+}
+
+/* Unhash and free a page, and its file once it has none left */
+static void page_free(page_t* page) {
+    pc_file_t* file = page->file;
+    
+    page_t** link = &hash_table[page_bucket(file->node, page->index)];
+    while (*link) {
+        if (*link == page) {
+            *link = page->hash_next;
+            break;
+        }
+        link = &(*link)->hash_next;
+    }
+    lru_unlink(page);
+    page_clear_dirty(page);
+    
+    if (page->file_prev) page->file_prev->file_next = page->file_next;
+    else file->pages = page->file_next;
+    if (page->file_next) page->file_next->file_prev = page->file_prev;
+    
+    kfree(page->data);
+    kfree(page);
+    stats.pages--;
+    
+    if (--file->count == 0) {
+        if (file->prev) file->prev->next = file->next;
+        else files = file->next;
+        if (file->next) file->next->prev = file->prev;
+        file->node->pages = 0;
+        kfree(file);
+        stats.files--;
+    }
+}
+
+/* Write a dirty page back through the filesystem */
+static int page_writeback(page_t* page) {
+    fs_node_t* node = page->file->node;
+    uint32_t offset = page->index << PAGE_SHIFT;
+    
+    if (offset < node->length && node->write) {
+        uint32_t len = node->length - offset;
+        if (len > PAGE_SIZE) len = PAGE_SIZE;
+        
+        busy++;
+        uint32_t written = node->write(node, offset, len, page->data);
+        busy--;
+        if (written != len) return -1;
+        stats.writebacks++;
+    }
+    
+    /* Past the end of file (truncated meanwhile): nothing left to save */
+    page_clear_dirty(page);
+    return 0;
+}
+
+/* Make room for one page: least recently used first, written back if dirty */
+static void evict_one(void) {
+    for (page_t* page = lru_tail; page; page = page->lru_prev) {
+        if ((page->flags & PAGE_DIRTY) && page_writeback(page) != 0) continue;
+        page_free(page);
+        stats.evictions++;
+        return;
+    }
+}
+
+/* New page (not yet in the cache), evicting to stay under the limit */
+static page_t* page_alloc(void) {
+    if (stats.pages >= stats.max_pages) evict_one();
+    
+    page_t* page = (page_t*)kcalloc(1, sizeof(page_t));
+    if (!page) return 0;
+    page->data = (uint8_t*)kmalloc(PAGE_SIZE);
+    if (!page->data) {
+        kfree(page);
+        return 0;
+    }
+    return page;
+}
+
+static void page_insert(pc_file_t* file, page_t* page, uint32_t index) {
+    uint32_t bucket = page_bucket(file->node, index);
+    
+    page->file = file;
+    page->index = index;
+    page->hash_next = hash_table[bucket];
+    hash_table[bucket] = page;
+    lru_push_front(page);
+    
+    page->file_prev = 0;
+    page->file_next = file->pages;
+    if (file->pages) file->pages->file_prev = page;
+    file->pages = page;
+    file->count++;
+    stats.pages++;
+}
+
+/* Read pages [first, last] that are missing, stopping at the first cached
+ * one, with a single (vectored) filesystem read. Returns page 'first'. */
+static page_t* page_fill(fs_node_t* node, uint32_t first, uint32_t last) {
+    page_t* run[PAGECACHE_FILL_MAX];
+    iovec_t iov[PAGECACHE_FILL_MAX];
+    
+    uint32_t want = 1;
+    while (want < PAGECACHE_FILL_MAX && first + want <= last && !page_lookup(node, first + want)) want++;
+    
+    uint32_t count = 0;
+    while (count < want) {
+        run[count] = page_alloc();
+        if (!run[count]) break;
+        iov[count].base = run[count]->data;
+        iov[count].len = PAGE_SIZE;
+        count++;
+    }
+    if (count == 0) return 0;
+    
+    uint32_t offset = first << PAGE_SHIFT;
+    uint32_t expect = node->length - offset;
+    if (expect > count * PAGE_SIZE) expect = count * PAGE_SIZE;
+    
+    uint32_t got;
+    busy++;
+    if (node->readv) {
+        got = node->readv(node, offset, iov, count);
+    } else {
+        got = 0;
+        for (uint32_t i = 0; i < count && got < expect; i++) {
+            uint32_t n = node->read(node, offset + got, PAGE_SIZE, run[i]->data);
+            got += n;
+            if (n < PAGE_SIZE) break;
+        }
+    }
+    busy--;
+    
+    pc_file_t* file = got >= expect ? file_get(node) : 0;
+    if (!file) {
+        for (uint32_t i = 0; i < count; i++) {
+            kfree(run[i]->data);
+            kfree(run[i]);
+        }
+        return 0;
+    }
+    
+    /* The page holding the end of file reads as zeros past it */
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t valid = expect > i * PAGE_SIZE ? expect - i * PAGE_SIZE : 0;
+        if (valid < PAGE_SIZE) kmemset(run[i]->data + valid, 0, PAGE_SIZE - valid);
+        page_insert(file, run[i], first + i);
+    }
+    stats.misses += count;
+    return run[0];
+}
+
+/* Copy freshly written file bytes into whatever pages are cached */
+static void refresh_pages(fs_node_t* node, uint32_t offset, uint32_t size, const uint8_t* buffer) {
+    if (!node->pages) return;
+    
+    uint32_t done = 0;
+    while (done < size) {
+        uint32_t pos = offset + done;
+        uint32_t in_page = pos & (PAGE_SIZE - 1);
+        uint32_t chunk = PAGE_SIZE - in_page;
+        if (chunk > size - done) chunk = size - done;
+        
+        page_t* page = page_lookup(node, pos >> PAGE_SHIFT);
+        if (page) kmemcpy(page->data + in_page, buffer + done, chunk);
+        done += chunk;
+    }
+}
+
+/* Heap shrinker: give back clean pages, oldest first */
+static size_t pagecache_shrink(size_t wanted) {
+    if (busy) return 0;
+    
+    size_t freed = 0;
+    page_t* page = lru_tail;
+    while (page && freed < wanted) {
+        page_t* prev = page->lru_prev;
+        if (!(page->flags & PAGE_DIRTY)) {
+            page_free(page);
+            stats.shrunk++;
+            freed += PAGE_SIZE;
+        }
+        page = prev;
+    }
+    return freed;
+}
+
+/**
+ * Set the cache size (pages) and hook into the heap's shrinker list
+ */
+int pagecache_init(uint32_t max_pages) {
+    if (max_pages == 0) return -1;
+    
+    if (!initialized) {
+        if (memory_register_shrinker(pagecache_shrink) != 0) return -1;
+        initialized = true;
+    }
+    
+    stats.max_pages = max_pages;
+    while (stats.pages > stats.max_pages && lru_tail) {
+        uint32_t before = stats.pages;
+        evict_one();
+        if (stats.pages == before) break;   /* Only unwritable dirty pages left */
+    }
+    return 0;
+}
+
+bool pagecache_enabled(fs_node_t* node) {
+    return initialized && node->fs && (node->flags & 0x7) == FS_FILE && !(node->flags & FS_NOCACHE) &&
+           (node->read != 0 || node->readv != 0);
+}
+
+/**
+ * Read file bytes, filling missing pages from the filesystem
+ */
+uint32_t pagecache_read(fs_node_t* node, uint32_t offset, uint32_t size, uint8_t* buffer) {
+    if (offset >= node->length || size == 0) return 0;
+    if (size > node->length - offset) size = node->length - offset;
+    
+    uint32_t last = (offset + size - 1) >> PAGE_SHIFT;
+    uint32_t filled_end = 0;    /* Pages before this were just read in */
+    uint32_t done = 0;
+    
+    while (done < size) {
+        uint32_t pos = offset + done;
+        uint32_t index = pos >> PAGE_SHIFT;
+        uint32_t in_page = pos & (PAGE_SIZE - 1);
+        uint32_t chunk = PAGE_SIZE - in_page;
+        if (chunk > size - done) chunk = size - done;
+        
+        page_t* page = page_lookup(node, index);
+        if (page) {
+            if (index >= filled_end) stats.hits++;
+            lru_touch(page);
+        } else {
+            page = page_fill(node, index, last);
+            if (!page) {
+                /* No memory for pages: read this one around the cache. Later
+                 * pages are still looked up, so dirty ones are never skipped. */
+                if (!node->read) break;
+                uint32_t got = node->read(node, pos, chunk, buffer + done);
+                done += got;
+                if (got < chunk) break;
+                continue;
+            }
+            filled_end = index + PAGECACHE_FILL_MAX;
+        }
+        
+        kmemcpy(buffer + done, page->data + in_page, chunk);
+        done += chunk;
+    }
+    return done;
+}
+
+/**
+ * Write file bytes. Inside the file they only dirty pages; writes that
+ * extend it go to the filesystem at once.
+ */
+uint32_t pagecache_write(fs_node_t* node, uint32_t offset, uint32_t size, uint8_t* buffer) {
+    if (size == 0 || !node->write) return 0;
+    
+    if (offset > node->length || size > node->length - offset) {
+        uint32_t written = node->write(node, offset, size, buffer);
+        refresh_pages(node, offset, written, buffer);
+        return written;
+    }
+    
+    uint32_t done = 0;
+    while (done < size) {
+        uint32_t pos = offset + done;
+        uint32_t index = pos >> PAGE_SHIFT;
+        uint32_t in_page = pos & (PAGE_SIZE - 1);
+        uint32_t chunk = PAGE_SIZE - in_page;
+        if (chunk > size - done) chunk = size - done;
+        
+        page_t* page = page_lookup(node, index);
+        if (page) {
+            stats.hits++;
+            lru_touch(page);
+        } else if (in_page == 0 && (chunk == PAGE_SIZE || pos + chunk >= node->length)) {
+            /* Everything the page holds gets overwritten: no need to read it */
+            page = page_alloc();
+            pc_file_t* file = page ? file_get(node) : 0;
+            if (file) {
+                kmemset(page->data, 0, PAGE_SIZE);
+                page_insert(file, page, index);
+            } else if (page) {
+                kfree(page->data);
+                kfree(page);
+                page = 0;
+            }
+        } else {
+            page = page_fill(node, index, index);
+        }
+        
+        if (!page) {
+            /* No memory for pages: write the rest through */
+            uint32_t written = node->write(node, pos, size - done, buffer + done);
+            refresh_pages(node, pos, written, buffer + done);
+            return done + written;
+        }
+        
+        kmemcpy(page->data + in_page, buffer + done, chunk);
+        page_set_dirty(page);
+        done += chunk;
+    }
+    return done;
+}
+
+static int sync_file(pc_file_t* file) {
+    int status = 0;
+    for (page_t* page = file->pages; page && file->dirty; page = page->file_next) {
+        if ((page->flags & PAGE_DIRTY) && page_writeback(page) != 0) status = -1;
+    }
+    return status;
+}
+
+/**
+ * Write dirty pages back through their filesystems
+ */
+int pagecache_sync(fs_node_t* node) {
+    if (node) return node->pages ? sync_file(node->pages) : 0;
+    
+    int status = 0;
+    for (pc_file_t* file = files; file; file = file->next) {
+        if (file->dirty && sync_file(file) != 0) status = -1;
+    }
+    return status;
+}
+
+/**
+ * The file was cut to 'length': pages past it are stale, and the bytes
+ * after the end in the last page must read back as zeros if it regrows.
+ */
+void pagecache_truncate(fs_node_t* node, uint32_t length) {
+    pc_file_t* file = node->pages;
+    if (!file) return;
+    
+    uint32_t keep = (length + PAGE_SIZE - 1) >> PAGE_SHIFT;
+    page_t* page = file->pages;
+    while (page) {
+        page_t* next = page->file_next;
+        if (page->index >= keep) {
+            page_free(page);   /* May free 'file' with the last page */
+        } else if (page->index == length >> PAGE_SHIFT) {
+            uint32_t in_page = length & (PAGE_SIZE - 1);
+            kmemset(page->data + in_page, 0, PAGE_SIZE - in_page);
+        }
+        page = next;
+    }
+}
+
+/**
+ * Drop all of a node's pages (it is leaving the inode cache or was deleted)
+ */
+void pagecache_drop(fs_node_t* node, bool write_back) {
+    if (!node->pages) return;
+    if (write_back) sync_file(node->pages);
+    
+    while (node->pages) page_free(node->pages->pages);
+}
+
+void pagecache_get_stats(pagecache_stats_t* out) {
+    kmemcpy(out, &stats, sizeof(pagecache_stats_t));
+}
+
+pc_file_t* pagecache_first_file(void) {
+    return files;
+}
@@ -0,0 +1,86 @@
+/**
+ * OpenWare OS - File Page Cache
+ * Copyright (c) 2026 Ventryx Inc. All rights reserved.
+ *
+ * 4KB pages of file data keyed by (node, page index), hashed for lookup,
+ * listed per file and kept on a global LRU. vfs_read/vfs_write go through
+ * it for regular files of cached filesystems. Writes inside the file are
+ * held as dirty pages and written back through the filesystem's write op;
+ * writes that grow the file go straight to the filesystem so it can
+ * allocate space. Clean pages are given back when the heap runs dry.
+ */
+
+#ifndef PAGECACHE_H
+#define PAGECACHE_H
+
+#include "../include/types.h"
+#include "vfs.h"
+
+#define PAGE_SIZE               4096
+#define PAGE_SHIFT              12
+#define PAGECACHE_DEFAULT_PAGES 256     /* 1MB of file data */
+#define PAGECACHE_BUCKETS       256     /* Must be a power of two */
+#define PAGECACHE_FILL_MAX      16      /* Pages filled by one read request */
+
+/* Page flags */
+#define PAGE_DIRTY      0x01
+
+struct pc_file;
+
+typedef struct page {
+    struct pc_file* file;
+    uint32_t index;             /* Page number within the file */
+    uint32_t flags;
+    uint8_t* data;
+    struct page* hash_next;
+    struct page* lru_prev;      /* Most recently used at the head */
+    struct page* lru_next;
+    struct page* file_prev;     /* Pages of the same file */
+    struct page* file_next;
+} page_t;
+
+/* Per-file state, hung off fs_node_t.pages while the file has pages */
+typedef struct pc_file {
+    fs_node_t* node;
+    page_t* pages;
+    uint32_t count;
+    uint32_t dirty;
+    struct pc_file* next;       /* Files with cached pages */
+    struct pc_file* prev;
+} pc_file_t;
+
+typedef struct {
+    uint32_t pages;             /* Cached now */
+    uint32_t max_pages;
+    uint32_t dirty;
+    uint32_t files;
+    uint32_t hits;              /* Pages found in the cache */
+    uint32_t misses;            /* Pages read from the filesystem */
+    uint32_t evictions;
+    uint32_t writebacks;        /* Pages written back */
+    uint32_t shrunk;            /* Pages given back to the heap */
+} pagecache_stats_t;
+
+int pagecache_init(uint32_t max_pages);
+
+/* True if reads and writes of this node go through the cache */
+bool pagecache_enabled(fs_node_t* node);
+
+uint32_t pagecache_read(fs_node_t* node, uint32_t offset, uint32_t size, uint8_t* buffer);
+uint32_t pagecache_write(fs_node_t* node, uint32_t offset, uint32_t size, uint8_t* buffer);
+
+/* Write dirty pages back through the filesystem (NULL: every file) */
+int pagecache_sync(fs_node_t* node);
+
+/* File shrinking to 'length': drop pages past it, clear the tail of the last */
+void pagecache_truncate(fs_node_t* node, uint32_t length);
+
+/* Drop every page of a node; dirty data is written back first if 'write_back' */
+void pagecache_drop(fs_node_t* node, bool write_back);
+
+void pagecache_get_stats(pagecache_stats_t* stats);
+
+/* Walk the files with cached pages (returns NULL after the last) */
+pc_file_t* pagecache_first_file(void);
+
+#endif
@@ -0,0 +1,81 @@
+/**
+ * OpenWare OS - Sequential Read-Ahead
+ * Copyright (c) 2026 Ventryx Inc. All rights reserved.
+ */
+
+#include "readahead.h"
+
+void readahead_init(readahead_t* ra) {
+    for (int i = 0; i < RA_STREAMS; i++) {
+        ra->streams[i].next_unit = 0;
+        ra->streams[i].ahead_start = 0;
+        ra->streams[i].ahead_end = 0;
+        ra->streams[i].window = 0;
+        ra->streams[i].last_use = 0;
+    }
+    ra->clock = 0;
+    ra->sequential = 0;
+    ra->random = 0;
+    ra->prefetched = 0;
+    ra->hits = 0;
+}
+
+/* Stream this read continues, or NULL. Re-reading the unit a stream just
+ * finished counts as continuing it too. */
+static ra_stream_t* find_stream(readahead_t* ra, uint32_t first) {
+    for (int i = 0; i < RA_STREAMS; i++) {
+        ra_stream_t* s = &ra->streams[i];
+        if (first == s->next_unit || (s->next_unit > 0 && first == s->next_unit - 1)) return s;
+    }
+    return NULL;
+}
+
+/**
+ * Classify the access and size the next prefetch.
+ * Sequential reads double their stream's window up to RA_MAX_WINDOW; a
+ * random read starts over in the least recently used stream, leaving the
+ * other readers' windows alone.
+ */
+uint32_t readahead_access(readahead_t* ra, uint32_t first, uint32_t last, uint32_t limit,
+                          uint32_t* start) {
+    for (int i = 0; i < RA_STREAMS; i++) {
+        if (first >= ra->streams[i].ahead_start && first < ra->streams[i].ahead_end) {
+            ra->hits++;
+            break;
+        }
+    }
+
+    ra_stream_t* s = find_stream(ra, first);
+    if (!s) {
+        s = &ra->streams[0];
+        for (int i = 1; i < RA_STREAMS; i++) {
+            if (ra->streams[i].last_use < s->last_use) s = &ra->streams[i];
+        }
+        s->next_unit = last + 1;
+        s->window = 0;
+        s->ahead_start = s->ahead_end = 0;
+        s->last_use = ++ra->clock;
+        ra->random++;
+        return 0;
+    }
+    s->next_unit = last + 1;
+    s->last_use = ++ra->clock;
+
+    ra->sequential++;
+    if (s->window == 0) s->window = RA_INITIAL_WINDOW;
+    else if (s->window < RA_MAX_WINDOW) s->window *= 2;
+    if (s->window > RA_MAX_WINDOW) s->window = RA_MAX_WINDOW;
+
+    /* Only ask for what isn't already on its way */
+    uint32_t from = last + 1;
+    uint32_t to = last + 1 + s->window;
+    if (to > limit) to = limit;
+    if (from < s->ahead_end) from = s->ahead_end;
+    if (from >= to) return 0;
+
+    if (s->ahead_end < last + 1) s->ahead_start = last + 1;
+    s->ahead_end = to;
+    ra->prefetched += to - from;
+    *start = from;
+    return to - from;
+}
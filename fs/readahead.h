@@ -0,0 +1,50 @@
+/**
+ * OpenWare OS - Sequential Read-Ahead
+ * Copyright (c) 2026 Ventryx Inc. All rights reserved.
+ *
+ * Per-file access pattern tracking. Units are whatever the filesystem
+ * prefetches in (FAT32 uses clusters). Nodes are shared by everyone who
+ * has the file open, so a few streams are followed at once: each read
+ * continues the stream it picks up from, and a read that continues none
+ * takes over the least recently used one.
+ */
+
+#ifndef READAHEAD_H
+#define READAHEAD_H
+
+#include "../include/types.h"
+
+#define RA_INITIAL_WINDOW   2       /* Units prefetched after the first sequential hit */
+#define RA_MAX_WINDOW       32      /* Cap for the exponential growth */
+#define RA_STREAMS          4       /* Interleaved readers followed per file */
+
+typedef struct ra_stream {
+    uint32_t next_unit;     /* Where a sequential reader will read next */
+    uint32_t ahead_start;   /* Prefetched range is [ahead_start, ahead_end) */
+    uint32_t ahead_end;
+    uint32_t window;        /* Current window size in units (0: not sequential) */
+    uint32_t last_use;      /* Access clock, to pick a stream to take over */
+} ra_stream_t;
+
+typedef struct readahead {
+    ra_stream_t streams[RA_STREAMS];
+    uint32_t clock;
+
+    /* Statistics */
+    uint32_t sequential;    /* Reads classified as sequential */
+    uint32_t random;        /* Reads classified as random */
+    uint32_t prefetched;    /* Units handed out for prefetch */
+    uint32_t hits;          /* Reads that landed in a prefetched range */
+} readahead_t;
+
+void readahead_init(readahead_t* ra);
+
+/*
+ * Record a read of units [first, last] of a file 'limit' units long.
+ * Returns how many units should be prefetched starting at *start
+ * (0: nothing to do).
+ */
+uint32_t readahead_access(readahead_t* ra, uint32_t first, uint32_t last, uint32_t limit,
+                          uint32_t* start);
+
+#endif
@@ -0,0 +1,442 @@
+/**
+ * OpenWare OS - Memory Filesystem (tmpfs)
+ * Copyright (c) 2026 Ventryx Inc. All rights reserved.
+ */
+
+#include "tmpfs.h"
+#include "../include/memory.h"
+
+static uint32_t tmpfs_read(fs_node_t* node, uint32_t offset, uint32_t size, uint8_t* buffer);
+static uint32_t tmpfs_write(fs_node_t* node, uint32_t offset, uint32_t size, uint8_t* buffer);
+static int tmpfs_truncate(fs_node_t* node, uint32_t length);
+static const uint8_t* tmpfs_map(fs_node_t* node, uint32_t offset, uint32_t size);
+static uint32_t tmpfs_readdir_batch(fs_node_t* node, uint32_t* pos, dirent_t* out, uint32_t max);
+static fs_node_t* tmpfs_finddir(fs_node_t* node, char* name);
+static fs_node_t* tmpfs_create(fs_node_t* dir, char* name, uint32_t type);
+static int tmpfs_unlink(fs_node_t* dir, char* name);
+static void tmpfs_release(fs_node_t* node);
+
+static inline tmpfs_node_t* tmpfs_state(fs_node_t* node) {
+    return (tmpfs_node_t*)node->impl_data;
+}
+
+/* Pages a tree of the given height can index */
+static inline uint32_t radix_capacity(uint32_t height) {
+    return height ? 1u << (height * TMPFS_RADIX_SHIFT) : 0;
+}
+
+/* Helper: Page 'index' of a file, or NULL for a hole */
+static uint8_t* radix_lookup(tmpfs_node_t* t, uint32_t index) {
+    if (!t->radix || index >= radix_capacity(t->height)) return 0;
+    
+    tmpfs_radix_t* r = t->radix;
+    for (uint32_t level = t->height - 1; level > 0; level--) {
+        r = (tmpfs_radix_t*)r->slots[(index >> (level * TMPFS_RADIX_SHIFT)) & (TMPFS_RADIX_SLOTS - 1)];
+        if (!r) return 0;
+    }
+    return (uint8_t*)r->slots[index & (TMPFS_RADIX_SLOTS - 1)];
+}
+
+/* Helper: Page 'index' of a file, allocated (zeroed) if it is a hole.
+ * NULL when out of memory or over the instance's size limit. */
+static uint8_t* radix_get_page(tmpfs_node_t* t, uint32_t index) {
+    /* Add levels on top until the tree reaches 'index' */
+    while (index >= radix_capacity(t->height)) {
+        tmpfs_radix_t* root = (tmpfs_radix_t*)kcalloc(1, sizeof(tmpfs_radix_t));
+        if (!root) return 0;
+        if (t->radix) {
+            root->slots[0] = t->radix;
+            root->used = 1;
+        }
+        t->radix = root;
+        t->height++;
+    }
+    
+    tmpfs_radix_t* r = t->radix;
+    for (uint32_t level = t->height - 1; level > 0; level--) {
+        uint32_t slot = (index >> (level * TMPFS_RADIX_SHIFT)) & (TMPFS_RADIX_SLOTS - 1);
+        if (!r->slots[slot]) {
+            r->slots[slot] = kcalloc(1, sizeof(tmpfs_radix_t));
+            if (!r->slots[slot]) return 0;
+            r->used++;
+        }
+        r = (tmpfs_radix_t*)r->slots[slot];
+    }
+    
+    uint32_t slot = index & (TMPFS_RADIX_SLOTS - 1);
+    if (!r->slots[slot]) {
+        if (t->sb->used_bytes + TMPFS_PAGE_SIZE > t->sb->max_bytes) return 0;
+        
+        uint8_t* page = (uint8_t*)kmalloc(TMPFS_PAGE_SIZE);
+        if (!page) return 0;
+        kmemset(page, 0, TMPFS_PAGE_SIZE);
+        r->slots[slot] = page;
+        r->used++;
+        t->sb->used_bytes += TMPFS_PAGE_SIZE;
+    }
+    return (uint8_t*)r->slots[slot];
+}
+
+/* Helper: Free every page at or past 'keep' below a subtree covering
+ * pages from 'base'. Returns true if the subtree is now empty. */
+static bool radix_trim(tmpfs_sb_t* sb, tmpfs_radix_t* r, uint32_t level, uint32_t base, uint32_t keep) {
+    uint32_t span = 1u << (level * TMPFS_RADIX_SHIFT);  /* Pages under one slot */
+    
+    for (uint32_t i = 0; i < TMPFS_RADIX_SLOTS; i++) {
+        if (!r->slots[i]) continue;
+        
+        uint32_t start = base + i * span;
+        if (start + span <= keep) continue;
+        
+        if (level == 0) {
+            kfree(r->slots[i]);
+            sb->used_bytes -= TMPFS_PAGE_SIZE;
+        } else {
+            tmpfs_radix_t* child = (tmpfs_radix_t*)r->slots[i];
+            if (!radix_trim(sb, child, level - 1, start, keep)) continue;
+            kfree(child);
+        }
+        r->slots[i] = 0;
+        r->used--;
+    }
+    return r->used == 0;
+}
+
+static void radix_truncate(tmpfs_node_t* t, uint32_t keep) {
+    if (!t->radix) return;
+    if (radix_trim(t->sb, t->radix, t->height - 1, 0, keep)) {
+        kfree(t->radix);
+        t->radix = 0;
+        t->height = 0;
+    }
+}
+
+static uint32_t name_hash(const char* name) {
+    uint32_t h = 2166136261u;   /* FNV-1a */
+    while (*name) {
+        h ^= (uint8_t)*name++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static bool name_equals(const char* a, const char* b) {
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+static tmpfs_dirent_t* dir_find(tmpfs_node_t* t, const char* name) {
+    if (!t->buckets) return 0;
+    
+    uint32_t hash = name_hash(name);
+    for (tmpfs_dirent_t* d = t->buckets[hash & (t->bucket_count - 1)]; d; d = d->hash_next) {
+        if (d->hash == hash && name_equals(d->name, name)) return d;
+    }
+    return 0;
+}
+
+/* Helper: Keep chains short by doubling the table as the directory grows */
+static bool dir_reserve(tmpfs_node_t* t) {
+    if (t->buckets && t->entries < t->bucket_count * 2) return true;
+    
+    uint32_t count = t->buckets ? t->bucket_count * 2 : TMPFS_DIR_MIN_BUCKETS;
+    tmpfs_dirent_t** buckets = (tmpfs_dirent_t**)kcalloc(count, sizeof(tmpfs_dirent_t*));
+    if (!buckets) return t->buckets != 0;   /* Longer chains still work */
+    
+    for (tmpfs_dirent_t* d = t->order_head; d; d = d->order_next) {
+        uint32_t b = d->hash & (count - 1);
+        d->hash_next = buckets[b];
+        buckets[b] = d;
+    }
+    kfree(t->buckets);
+    t->buckets = buckets;
+    t->bucket_count = count;
+    return true;
+}
+
+static bool dir_insert(tmpfs_node_t* t, const char* name, fs_node_t* node) {
+    if (!dir_reserve(t)) return false;
+    
+    uint32_t len = 0;
+    while (name[len]) len++;
+    
+    tmpfs_dirent_t* d = (tmpfs_dirent_t*)kmalloc(sizeof(tmpfs_dirent_t) + len + 1);
+    if (!d) return false;
+    kmemcpy(d->name, name, len + 1);
+    d->node = node;
+    d->hash = name_hash(name);
+    d->cookie = ++t->next_cookie;
+    
+    uint32_t b = d->hash & (t->bucket_count - 1);
+    d->hash_next = t->buckets[b];
+    t->buckets[b] = d;
+    
+    d->order_next = 0;
+    d->order_prev = t->order_tail;
+    if (t->order_tail) t->order_tail->order_next = d;
+    else t->order_head = d;
+    t->order_tail = d;
+    
+    t->entries++;
+    return true;
+}
+
+static void dir_remove(tmpfs_node_t* t, tmpfs_dirent_t* d) {
+    tmpfs_dirent_t** link = &t->buckets[d->hash & (t->bucket_count - 1)];
+    while (*link) {
+        if (*link == d) {
+            *link = d->hash_next;
+            break;
+        }
+        link = &(*link)->hash_next;
+    }
+    
+    if (d->order_prev) d->order_prev->order_next = d->order_next;
+    else t->order_head = d->order_next;
+    if (d->order_next) d->order_next->order_prev = d->order_prev;
+    else t->order_tail = d->order_prev;
+    
+    if (t->resume == d) t->resume = d->order_next;
+    t->entries--;
+    kfree(d);
+}
+
+/* Helper: Build a node; its first reference belongs to whoever links it */
+static fs_node_t* tmpfs_new_node(tmpfs_sb_t* sb, fs_node_t* parent, const char* name, uint32_t type) {
+    fs_node_t* node = (fs_node_t*)kcalloc(1, sizeof(fs_node_t));
+    tmpfs_node_t* t = (tmpfs_node_t*)kcalloc(1, sizeof(tmpfs_node_t));
+    if (!node || !t) {
+        kfree(node);
+        kfree(t);
+        return 0;
+    }
+    
+    for (uint32_t i = 0; name[i] && i < sizeof(node->name) - 1; i++) node->name[i] = name[i];
+    node->flags = type | FS_NOCACHE;   /* Data is in memory already */
+    node->inode = sb->next_inode++;
+    node->fs = sb;
+    node->impl_data = t;
+    t->sb = sb;
+    t->parent = parent;
+    
+    node->release = tmpfs_release;
+    if (type == FS_DIRECTORY) {
+        node->readdir_batch = tmpfs_readdir_batch;
+        node->finddir = tmpfs_finddir;
+        node->create = tmpfs_create;
+        node->unlink = tmpfs_unlink;
+    } else {
+        node->read = tmpfs_read;
+        node->write = tmpfs_write;
+        node->truncate = tmpfs_truncate;
+        node->map = tmpfs_map;
+    }
+    
+    vfs_icache_add(node);
+    return node;
+}
+
+/**
+ * Create a tmpfs instance and mount it. The instance keeps its root, so
+ * the contents survive an unmount until the next boot.
+ */
+int tmpfs_mount(const char* path, uint32_t max_bytes) {
+    tmpfs_sb_t* sb = (tmpfs_sb_t*)kcalloc(1, sizeof(tmpfs_sb_t));
+    if (!sb) return -1;
+    sb->max_bytes = max_bytes;
+    sb->next_inode = 1;
+    
+    fs_node_t* root = tmpfs_new_node(sb, 0, "", FS_DIRECTORY);
+    if (!root) {
+        kfree(sb);
+        return -1;
+    }
+    
+    if (vfs_mount(path, root) != 0) {
+        vfs_icache_forget(root);
+        vfs_node_put(root);
+        kfree(sb);
+        return -1;
+    }
+    return 0;
+}
+
+/* Read file content; holes read as zeros */
+static uint32_t tmpfs_read(fs_node_t* node, uint32_t offset, uint32_t size, uint8_t* buffer) {
+    tmpfs_node_t* t = tmpfs_state(node);
+    
+    if (offset >= node->length || size == 0) return 0;
+    if (size > node->length - offset) size = node->length - offset;
+    
+    uint32_t done = 0;
+    while (done < size) {
+        uint32_t pos = offset + done;
+        uint32_t in_page = pos & (TMPFS_PAGE_SIZE - 1);
+        uint32_t chunk = TMPFS_PAGE_SIZE - in_page;
+        if (chunk > size - done) chunk = size - done;
+        
+        uint8_t* page = radix_lookup(t, pos >> TMPFS_PAGE_SHIFT);
+        if (page) kmemcpy(buffer + done, page + in_page, chunk);
+        else kmemset(buffer + done, 0, chunk);
+        done += chunk;
+    }
+    return done;
+}
+
+/* Write file content, growing the file. Stops short at the size limit. */
+static uint32_t tmpfs_write(fs_node_t* node, uint32_t offset, uint32_t size, uint8_t* buffer) {
+    tmpfs_node_t* t = tmpfs_state(node);
+    
+    if (size > 0xFFFFFFFF - offset) size = 0xFFFFFFFF - offset;
+    
+    uint32_t done = 0;
+    while (done < size) {
+        uint32_t pos = offset + done;
+        uint32_t in_page = pos & (TMPFS_PAGE_SIZE - 1);
+        uint32_t chunk = TMPFS_PAGE_SIZE - in_page;
+        if (chunk > size - done) chunk = size - done;
+        
+        uint8_t* page = radix_get_page(t, pos >> TMPFS_PAGE_SHIFT);
+        if (!page) break;
+        kmemcpy(page + in_page, buffer + done, chunk);
+        done += chunk;
+    }
+    
+    if (done > 0 && offset + done > node->length) node->length = offset + done;
+    return done;
+}
+
+/* Resize a file. Growing leaves a hole; shrinking frees whole pages and
+ * clears the cut-off part of the last one so it reads as zeros later. */
+static int tmpfs_truncate(fs_node_t* node, uint32_t length) {
+    tmpfs_node_t* t = tmpfs_state(node);
+    
+    if (length < node->length) {
+        radix_truncate(t, (length + TMPFS_PAGE_SIZE - 1) >> TMPFS_PAGE_SHIFT);
+        
+        uint32_t in_page = length & (TMPFS_PAGE_SIZE - 1);
+        uint8_t* page = in_page ? radix_lookup(t, length >> TMPFS_PAGE_SHIFT) : 0;
+        if (page) kmemset(page + in_page, 0, TMPFS_PAGE_SIZE - in_page);
+    }
+    node->length = length;
+    return 0;
+}
+
+/* Map file content in place. Pages are separate allocations, so only
+ * ranges inside one present page can be mapped. */
+static const uint8_t* tmpfs_map(fs_node_t* node, uint32_t offset, uint32_t size) {
+    if (size == 0 || offset >= node->length || size > node->length - offset) return 0;
+    if ((offset >> TMPFS_PAGE_SHIFT) != ((offset + size - 1) >> TMPFS_PAGE_SHIFT)) return 0;
+    
+    uint8_t* page = radix_lookup(tmpfs_state(node), offset >> TMPFS_PAGE_SHIFT);
+    return page ? page + (offset & (TMPFS_PAGE_SIZE - 1)) : 0;
+}
+
+/* Read entries in creation order; *pos is the cookie of the next one */
+static uint32_t tmpfs_readdir_batch(fs_node_t* node, uint32_t* pos, dirent_t* out, uint32_t max) {
+    tmpfs_node_t* t = tmpfs_state(node);
+    
+    /* Usually the stream continues where the last batch left off */
+    tmpfs_dirent_t* d;
+    if (*pos == 0) {
+        d = t->order_head;
+    } else if (t->resume && t->resume->cookie == *pos) {
+        d = t->resume;
+    } else {
+        d = t->order_head;
+        while (d && d->cookie < *pos) d = d->order_next;
+    }
+    
+    uint32_t count = 0;
+    while (d && count < max) {
+        dirent_t* e = &out[count++];
+        uint32_t i;
+        for (i = 0; d->name[i] && i < sizeof(e->name) - 1; i++) e->name[i] = d->name[i];
+        e->name[i] = 0;
+        e->inode = d->node->inode;
+        e->type = d->node->flags & 0x7;
+        d = d->order_next;
+    }
+    
+    *pos = d ? d->cookie : t->next_cookie + 1;
+    t->resume = d;
+    return count;
+}
+
+/* Find a name; returns a referenced node */
+static fs_node_t* tmpfs_finddir(fs_node_t* node, char* name) {
+    tmpfs_node_t* t = tmpfs_state(node);
+    fs_node_t* found;
+    
+    if (name[0] == '.' && name[1] == 0) {
+        found = node;
+    } else if (name[0] == '.' && name[1] == '.' && name[2] == 0) {
+        found = t->parent ? t->parent : node;
+    } else {
+        tmpfs_dirent_t* d = dir_find(t, name);
+        if (!d) return 0;
+        found = d->node;
+    }
+    
+    vfs_node_get(found);
+    return found;
+}
+
+static fs_node_t* tmpfs_create(fs_node_t* dir, char* name, uint32_t type) {
+    tmpfs_node_t* t = tmpfs_state(dir);
+    
+    if (type != FS_FILE && type != FS_DIRECTORY) return 0;
+    
+    uint32_t len = 0;
+    while (name[len]) {
+        if (name[len] == '/') return 0;
+        len++;
+    }
+    if (len == 0 || len > VFS_NAME_MAX) return 0;
+    if (name[0] == '.' && (len == 1 || (len == 2 && name[1] == '.'))) return 0;
+    if (dir_find(t, name)) return 0;
+    
+    fs_node_t* node = tmpfs_new_node(t->sb, dir, name, type);
+    if (!node) return 0;
+    
+    if (!dir_insert(t, name, node)) {
+        vfs_icache_forget(node);
+        vfs_node_put(node);
+        return 0;
+    }
+    
+    /* The entry keeps the first reference; this one is the caller's */
+    vfs_node_get(node);
+    return node;
+}
+
+static int tmpfs_unlink(fs_node_t* dir, char* name) {
+    tmpfs_node_t* t = tmpfs_state(dir);
+    
+    tmpfs_dirent_t* d = dir_find(t, name);
+    if (!d) return -1;
+    
+    fs_node_t* node = d->node;
+    if ((node->flags & 0x7) == FS_DIRECTORY && tmpfs_state(node)->entries > 0) return -1;
+    
+    dir_remove(t, d);
+    
+    /* Open handles keep the node (and its data) until they close */
+    vfs_icache_forget(node);
+    vfs_node_put(node);
+    return 0;
+}
+
+/* Last reference gone (after unlink): give the memory back */
+static void tmpfs_release(fs_node_t* node) {
+    tmpfs_node_t* t = tmpfs_state(node);
+    if (!t) return;
+    
+    radix_truncate(t, 0);
+    kfree(t->buckets);
+    kfree(t);
+    node->impl_data = 0;
+}
@@ -0,0 +1,69 @@
+/**
+ * OpenWare OS - Memory Filesystem (tmpfs)
+ * Copyright (c) 2026 Ventryx Inc. All rights reserved.
+ *
+ * Files and directories that live only in the kernel heap. File data is
+ * kept in 4KB pages found through a radix tree (holes cost nothing and
+ * read as zeros); directories are hash maps of names. Every node is held
+ * by its directory entry, so nothing leaves the inode cache until it is
+ * unlinked. A size limit caps the data pages of each instance.
+ */
+
+#ifndef TMPFS_H
+#define TMPFS_H
+
+#include "../include/types.h"
+#include "vfs.h"
+
+#define TMPFS_PAGE_SIZE         4096
+#define TMPFS_PAGE_SHIFT        12
+#define TMPFS_RADIX_SHIFT       6
+#define TMPFS_RADIX_SLOTS       (1 << TMPFS_RADIX_SHIFT)
+#define TMPFS_DIR_MIN_BUCKETS   8           /* Power of two, doubled as entries grow */
+#define TMPFS_DEFAULT_MAX       (1024 * 1024)   /* Bytes of file data */
+
+typedef struct tmpfs_radix {
+    void* slots[TMPFS_RADIX_SLOTS];     /* Child nodes, or pages at the bottom */
+    uint32_t used;                      /* Non-NULL slots */
+} tmpfs_radix_t;
+
+typedef struct tmpfs_dirent {
+    struct tmpfs_dirent* hash_next;
+    struct tmpfs_dirent* order_prev;    /* Creation order, for readdir */
+    struct tmpfs_dirent* order_next;
+    fs_node_t* node;                    /* Referenced by the entry */
+    uint32_t hash;
+    uint32_t cookie;                    /* Directory stream position */
+    char name[];
+} tmpfs_dirent_t;
+
+/* One mounted instance */
+typedef struct tmpfs_sb {
+    uint32_t max_bytes;
+    uint32_t used_bytes;                /* Data pages allocated */
+    uint32_t next_inode;
+} tmpfs_sb_t;
+
+/* Per-node state (fs_node_t.impl_data) */
+typedef struct tmpfs_node {
+    tmpfs_sb_t* sb;
+    fs_node_t* parent;                  /* Directory holding our entry */
+    
+    /* Files: page tree covering indices below 64^height */
+    tmpfs_radix_t* radix;
+    uint32_t height;
+    
+    /* Directories */
+    tmpfs_dirent_t** buckets;
+    uint32_t bucket_count;
+    uint32_t entries;
+    tmpfs_dirent_t* order_head;
+    tmpfs_dirent_t* order_tail;
+    uint32_t next_cookie;
+    tmpfs_dirent_t* resume;             /* Entry the last stream batch stopped at */
+} tmpfs_node_t;
+
+/* New instance limited to 'max_bytes' of data, attached at 'path' ("/": root) */
+int tmpfs_mount(const char* path, uint32_t max_bytes);
+
+#endif
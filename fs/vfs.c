@@ -4,22 +4,273 @@
  */
 
 #include "vfs.h"
+#include "dcache.h"
+#include "pagecache.h"
+#include "../include/memory.h"
+#include "../include/blkqueue.h"
 
 fs_node_t* fs_root = 0;
 
+typedef struct {
+    fs_node_t* mountpoint;      /* Directory covered by the mount */
+    fs_node_t* root;            /* Root of the mounted filesystem */
+} vfs_mount_t;
+
+static vfs_mount_t mounts[VFS_MAX_MOUNTS];
+static vfs_mount_t* find_mount(fs_node_t* node, bool by_root);
+
+static fs_node_t* icache_hash[VFS_ICACHE_BUCKETS];
+
+/* Unreferenced cached nodes: head is most recently used */
+static fs_node_t* unused_head = 0;
+static fs_node_t* unused_tail = 0;
+static uint32_t unused_count = 0;
+
+static uint32_t icache_bucket(void* fs, uint32_t inode) {
+    uint32_t h = (inode ^ ((uint32_t)fs >> 4)) * 0x9E3779B1;
+    return (h >> 16) & (VFS_ICACHE_BUCKETS - 1);
+}
+
+static void unused_unlink(fs_node_t* node) {
+    if (node->lru_prev) node->lru_prev->lru_next = node->lru_next;
+    else unused_head = node->lru_next;
+    if (node->lru_next) node->lru_next->lru_prev = node->lru_prev;
+    else unused_tail = node->lru_prev;
+    node->lru_prev = node->lru_next = 0;
+    unused_count--;
+}
+
+static void unused_push_front(fs_node_t* node) {
+    node->lru_prev = 0;
+    node->lru_next = unused_head;
+    if (unused_head) unused_head->lru_prev = node;
+    unused_head = node;
+    if (!unused_tail) unused_tail = node;
+    unused_count++;
+}
+
+/* Take a node out of the hash; returns false if it wasn't there */
+static bool icache_unhash(fs_node_t* node) {
+    fs_node_t** link = &icache_hash[icache_bucket(node->fs, node->inode)];
+    while (*link) {
+        if (*link == node) {
+            *link = node->hash_next;
+            node->hash_next = 0;
+            return true;
+        }
+        link = &(*link)->hash_next;
+    }
+    return false;
+}
+
+static bool icache_hashed(fs_node_t* node) {
+    for (fs_node_t* n = icache_hash[icache_bucket(node->fs, node->inode)]; n; n = n->hash_next) {
+        if (n == node) return true;
+    }
+    return false;
+}
+
+/* Drop a node from the cache for good */
+static void icache_evict(fs_node_t* node) {
+    icache_unhash(node);
+    
+    /* Cached file data goes with the node; dirty pages are saved first */
+    pagecache_drop(node, true);
+    if (node->release != 0)
+        node->release(node);
+    kfree(node);
+}
+
+/**
+ * Find a cached node and take a reference on it
+ */
+fs_node_t* vfs_icache_get(void* fs, uint32_t inode) {
+    fs_node_t* node = icache_hash[icache_bucket(fs, inode)];
+    while (node) {
+        if (node->fs == fs && node->inode == inode) {
+            if (node->refcount == 0) unused_unlink(node);
+            node->refcount++;
+            return node;
+        }
+        node = node->hash_next;
+    }
+    return 0;
+}
+
+/**
+ * The file behind a node was deleted: later lookups must not find it,
+ * and it is freed once the last reference is dropped.
+ */
+void vfs_icache_forget(fs_node_t* node) {
+    icache_unhash(node);
+    pagecache_drop(node, false);   /* Nothing left on disk to write back to */
+}
+
+/**
+ * Insert a freshly built node (kmalloc'd, fs and inode set). The caller
+ * holds the first reference.
+ */
+void vfs_icache_add(fs_node_t* node) {
+    uint32_t bucket = icache_bucket(node->fs, node->inode);
+    node->refcount = 1;
+    node->lru_prev = node->lru_next = 0;
+    node->hash_next = icache_hash[bucket];
+    icache_hash[bucket] = node;
+}
+
 uint32_t vfs_read(fs_node_t* node, uint32_t offset, uint32_t size, uint8_t* buffer) {
+    if (pagecache_enabled(node))
+        return pagecache_read(node, offset, size, buffer);
     if (node->read != 0)
         return node->read(node, offset, size, buffer);
     return 0;
 }
 
 uint32_t vfs_write(fs_node_t* node, uint32_t offset, uint32_t size, uint8_t* buffer) {
+    if (node->write != 0 && pagecache_enabled(node))
+        return pagecache_write(node, offset, size, buffer);
     if (node->write != 0)
         return node->write(node, offset, size, buffer);
     return 0;
 }
 
+/* Total bytes described by an iovec array */
+static uint32_t iov_total(const iovec_t* iov, uint32_t count) {
+    uint32_t total = 0;
+    for (uint32_t i = 0; i < count; i++) total += iov[i].len;
+    return total;
+}
+
+/**
+ * Scatter a contiguous file range into several buffers, in order.
+ * Returns the bytes transferred; a short count means end of file or error.
+ */
+uint32_t vfs_readv(fs_node_t* node, uint32_t offset, const iovec_t* iov, uint32_t count) {
+    /* Cached files are served from their pages, one segment at a time */
+    if (node->readv != 0 && !pagecache_enabled(node))
+        return node->readv(node, offset, iov, count);
+    
+    uint32_t done = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t n = vfs_read(node, offset + done, iov[i].len, iov[i].base);
+        done += n;
+        if (n < iov[i].len) break;
+    }
+    return done;
+}
+
+/**
+ * Gather several buffers into a contiguous file range, in order
+ */
+uint32_t vfs_writev(fs_node_t* node, uint32_t offset, const iovec_t* iov, uint32_t count) {
+    if (node->writev != 0 && !pagecache_enabled(node))
+        return node->writev(node, offset, iov, count);
+    
+    uint32_t done = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t n = vfs_write(node, offset + done, iov[i].len, iov[i].base);
+        done += n;
+        if (n < iov[i].len) break;
+    }
+    return done;
+}
+
+/* Queued asynchronous reads, oldest first */
+static vfs_aio_t* aio_head = 0;
+static vfs_aio_t* aio_tail = 0;
+static uint32_t aio_queued = 0;
+
+/**
+ * Queue an asynchronous read. Returns 0 once queued, -1 if the request
+ * is unusable (it is not queued and 'complete' is not called).
+ */
+int vfs_read_async(vfs_aio_t* req) {
+    if (!req || !req->node || (req->iov_count && !req->iov)) return -1;
+    if (req->node->read == 0 && req->node->readv == 0) return -1;
+    
+    vfs_node_get(req->node);
+    req->result = 0;
+    req->status = VFS_AIO_PENDING;
+    req->next = 0;
+    
+    /* Queue the device I/O without waiting for it; the copy happens at
+     * completion time */
+    if (req->node->prefetch != 0)
+        req->node->prefetch(req->node, req->offset, iov_total(req->iov, req->iov_count));
+    
+    if (aio_tail) aio_tail->next = req;
+    else aio_head = req;
+    aio_tail = req;
+    aio_queued++;
+    return 0;
+}
+
+/**
+ * Complete the requests queued so far: dispatch the device I/O they
+ * queued, then copy each one out of the cache. Callbacks may queue more;
+ * those wait for the next poll.
+ */
+uint32_t vfs_aio_poll(void) {
+    uint32_t budget = aio_queued;
+    uint32_t completed = 0;
+    
+    blkq_poll();
+    
+    while (completed < budget && aio_head) {
+        vfs_aio_t* req = aio_head;
+        aio_head = req->next;
+        if (!aio_head) aio_tail = 0;
+        aio_queued--;
+        req->next = 0;
+        
+        req->result = vfs_readv(req->node, req->offset, req->iov, req->iov_count);
+        req->status = VFS_AIO_DONE;
+        vfs_node_put(req->node);
+        completed++;
+        
+        if (req->complete) req->complete(req);
+    }
+    return completed;
+}
+
+/**
+ * Wait for one request, completing queued work until it is done
+ */
+int vfs_aio_wait(vfs_aio_t* req) {
+    while (req->status == VFS_AIO_PENDING) {
+        if (vfs_aio_poll() == 0) return VFS_AIO_ERROR;  /* Never queued */
+    }
+    return req->status;
+}
+
+void vfs_node_get(fs_node_t* node) {
+    if (node->fs) {
+        if (node->refcount == 0) unused_unlink(node);
+        node->refcount++;
+    }
+}
+
+void vfs_node_put(fs_node_t* node) {
+    if (!node->fs || node->refcount == 0) return;
+    if (--node->refcount > 0) return;
+    
+    /* Forgotten (deleted) nodes go as soon as nobody uses them */
+    if (!icache_hashed(node)) {
+        icache_evict(node);
+        return;
+    }
+    
+    /* Keep it around for the next lookup, within limits */
+    unused_push_front(node);
+    while (unused_count > VFS_ICACHE_MAX_UNUSED) {
+        fs_node_t* victim = unused_tail;
+        unused_unlink(victim);
+        icache_evict(victim);
+    }
+}
+
 void vfs_open(fs_node_t* node) {
+    vfs_node_get(node);
     if (node->open != 0)
         node->open(node);
 }
@@ -27,6 +278,7 @@ void vfs_open(fs_node_t* node) {
 void vfs_close(fs_node_t* node) {
     if (node->close != 0)
         node->close(node);
+    vfs_node_put(node);
 }
 
 dirent_t* vfs_readdir(fs_node_t* node, uint32_t index) {
@@ -35,8 +287,261 @@ dirent_t* vfs_readdir(fs_node_t* node, uint32_t index) {
     return 0;
 }
 
+/**
+ * Open a directory stream. The stream holds a reference to the directory.
+ */
+vfs_dir_t* vfs_opendir(fs_node_t* node) {
+    if (!node || (node->flags & 0x7) != FS_DIRECTORY) return 0;
+    if (node->readdir_batch == 0 && node->readdir == 0) return 0;
+    
+    vfs_dir_t* dir = (vfs_dir_t*)kmalloc(sizeof(vfs_dir_t));
+    if (!dir) return 0;
+    
+    vfs_node_get(node);
+    dir->node = node;
+    dir->pos = 0;
+    return dir;
+}
+
+/**
+ * Fill 'out' with up to 'max' entries, continuing from the last call.
+ * Returns how many were filled; 0 means the end of the directory.
+ */
+uint32_t vfs_readdir_batch(vfs_dir_t* dir, dirent_t* out, uint32_t max) {
+    fs_node_t* node = dir->node;
+    if (node->readdir_batch != 0)
+        return node->readdir_batch(node, &dir->pos, out, max);
+    
+    /* Index-only filesystem: copy entries out one at a time */
+    uint32_t count = 0;
+    while (count < max) {
+        dirent_t* entry = node->readdir(node, dir->pos);
+        if (!entry) break;
+        kmemcpy(&out[count++], entry, sizeof(dirent_t));
+        dir->pos++;
+    }
+    return count;
+}
+
+void vfs_closedir(vfs_dir_t* dir) {
+    if (!dir) return;
+    vfs_node_put(dir->node);
+    kfree(dir);
+}
+
 fs_node_t* vfs_finddir(fs_node_t* node, char* name) {
-    if (node->finddir != 0)
-        return node->finddir(node, name);
+    if (node->finddir == 0) return 0;
+    
+    fs_node_t* found;
+    if (dcache_lookup(node, name, &found)) return found;
+    
+    found = node->finddir(node, name);
+    dcache_add(node, name, found);
+    return found;
+}
+
+fs_node_t* vfs_create(fs_node_t* dir, char* name, uint32_t type) {
+    if (dir->create == 0) return 0;
+    
+    fs_node_t* node = dir->create(dir, name, type);
+    if (node) dcache_invalidate(dir);   /* Drops the negative entry, if any */
+    return node;
+}
+
+int vfs_unlink(fs_node_t* dir, char* name) {
+    if (dir->unlink == 0) return -1;
+    
+    /* Something is mounted on it: it has to stay */
+    fs_node_t* victim = vfs_finddir(dir, name);
+    if (victim) {
+        bool covered = find_mount(victim, false) != 0;
+        vfs_node_put(victim);
+        if (covered) return -1;
+    }
+    
+    /* Cached names pin the victim: let go of them first */
+    dcache_invalidate(dir);
+    return dir->unlink(dir, name);
+}
+
+int vfs_truncate(fs_node_t* node, uint32_t length) {
+    if (node->truncate == 0) return -1;
+    
+    int result = node->truncate(node, length);
+    if (result == 0) pagecache_truncate(node, length);
+    return result;
+}
+
+const uint8_t* vfs_map(fs_node_t* node, uint32_t offset, uint32_t size) {
+    if (node->map == 0) return 0;
+    
+    /* The mapping shows what the filesystem holds: flush cached writes */
+    pagecache_sync(node);
+    return node->map(node, offset, size);
+}
+
+/* Mount slot whose mountpoint (or root, if by_root) is 'node' */
+static vfs_mount_t* find_mount(fs_node_t* node, bool by_root) {
+    for (int i = 0; i < VFS_MAX_MOUNTS; i++) {
+        if (!mounts[i].root) continue;
+        if ((by_root ? mounts[i].root : mounts[i].mountpoint) == node) return &mounts[i];
+    }
+    return 0;
+}
+
+/**
+ * Resolve a path one component at a time. "." and empty components are
+ * skipped; ".." at the root of a mounted filesystem steps out through
+ * its mount point.
+ */
+fs_node_t* vfs_lookup_path(const char* path) {
+    if (!fs_root || !path) return 0;
+    
+    fs_node_t* node = fs_root;
+    vfs_node_get(node);
+    
+    char name[VFS_NAME_MAX + 1];
+    while (*path) {
+        while (*path == '/') path++;
+        if (!*path) break;
+        
+        uint32_t len = 0;
+        while (path[len] && path[len] != '/') {
+            if (len == VFS_NAME_MAX) {
+                vfs_node_put(node);
+                return 0;
+            }
+            name[len] = path[len];
+            len++;
+        }
+        name[len] = 0;
+        path += len;
+        
+        if (len == 1 && name[0] == '.') continue;
+        
+        if (len == 2 && name[0] == '.' && name[1] == '.') {
+            if (node == fs_root) continue;
+            
+            /* Leave a mounted filesystem through where it is attached */
+            vfs_mount_t* m;
+            while ((m = find_mount(node, true)) != 0) {
+                vfs_node_get(m->mountpoint);
+                vfs_node_put(node);
+                node = m->mountpoint;
+            }
+        }
+        
+        if ((node->flags & 0x7) != FS_DIRECTORY) {
+            vfs_node_put(node);
+            return 0;
+        }
+        
+        fs_node_t* next = vfs_finddir(node, name);
+        vfs_node_put(node);
+        if (!next) return 0;
+        node = next;
+        
+        /* Step onto whatever is mounted here (mounts can stack) */
+        vfs_mount_t* m;
+        while ((m = find_mount(node, false)) != 0) {
+            vfs_node_get(m->root);
+            vfs_node_put(node);
+            node = m->root;
+        }
+    }
+    
+    return node;
+}
+
+/**
+ * Split off the last component of a path and resolve the rest
+ */
+fs_node_t* vfs_lookup_parent(const char* path, char* name) {
+    if (!path) return 0;
+    
+    /* Last component, ignoring trailing slashes */
+    int end = 0;
+    while (path[end]) end++;
+    while (end > 0 && path[end - 1] == '/') end--;
+    int start = end;
+    while (start > 0 && path[start - 1] != '/') start--;
+    
+    if (end == start || end - start > VFS_NAME_MAX) return 0;
+    for (int i = start; i < end; i++) name[i - start] = path[i];
+    name[end - start] = 0;
+    
+    /* Resolve the directory part (copied, since it isn't terminated) */
+    char* dir_path = (char*)kmalloc(start + 1);
+    if (!dir_path) return 0;
+    kmemcpy(dir_path, path, start);
+    dir_path[start] = 0;
+    
+    fs_node_t* dir = vfs_lookup_path(dir_path);
+    kfree(dir_path);
+    
+    if (dir && (dir->flags & 0x7) != FS_DIRECTORY) {
+        vfs_node_put(dir);
+        return 0;
+    }
+    return dir;
+}
+
+/**
+ * Attach 'root' at the directory 'path'. The mount keeps references on
+ * both nodes until vfs_umount.
+ */
+int vfs_mount(const char* path, fs_node_t* root) {
+    if (!path || !root || (root->flags & 0x7) != FS_DIRECTORY) return -1;
+    
+    /* "/" (or nothing mounted yet): becomes the root itself */
+    const char* p = path;
+    while (*p == '/') p++;
+    if (*p == 0 || !fs_root) {
+        vfs_node_get(root);
+        if (fs_root) {
+            dcache_invalidate(0);
+            vfs_node_put(fs_root);
+        }
+        fs_root = root;
+        return 0;
+    }
+    
+    fs_node_t* dir = vfs_lookup_path(path);
+    if (!dir) return -1;
+    if ((dir->flags & 0x7) != FS_DIRECTORY) {
+        vfs_node_put(dir);
+        return -1;
+    }
+    
+    for (int i = 0; i < VFS_MAX_MOUNTS; i++) {
+        if (!mounts[i].root) {
+            vfs_node_get(root);
+            mounts[i].mountpoint = dir;     /* Keeps the lookup reference */
+            mounts[i].root = root;
+            return 0;
+        }
+    }
+    
+    vfs_node_put(dir);
+    return -1;
+}
+
+/**
+ * Detach the filesystem mounted at 'path'
+ */
+int vfs_umount(const char* path) {
+    fs_node_t* root = vfs_lookup_path(path);
+    if (!root) return -1;
+    
+    vfs_mount_t* m = find_mount(root, true);
+    vfs_node_put(root);
+    if (!m) return -1;
+    
+    /* Cached names may still pin nodes of the detached filesystem */
+    dcache_invalidate(0);
+    vfs_node_put(m->mountpoint);
+    vfs_node_put(m->root);
+    m->mountpoint = 0;
+    m->root = 0;
     return 0;
 }
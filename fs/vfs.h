@@ -7,42 +7,149 @@
 #define VFS_H
 
 #include "../include/types.h"
+#include "readahead.h"
 
 #define FS_FILE        0x01
 #define FS_DIRECTORY   0x02
 #define FS_CHARDEVICE  0x03
 #define FS_BLOCKDEVICE 0x04
+#define FS_NOCACHE     0x08 /* Flag: data lives in memory, bypass the page cache */
+
+#define VFS_ICACHE_BUCKETS      64      /* Must be a power of two */
+#define VFS_ICACHE_MAX_UNUSED   64      /* Unreferenced nodes kept for reuse */
+#define VFS_MAX_MOUNTS          8
+#define VFS_NAME_MAX            127     /* Longest path component */
 
 typedef struct dirent {
     char name[128];
     uint32_t inode;
+    uint32_t type;  /* FS_FILE / FS_DIRECTORY */
 } dirent_t;
 
+/* One segment of a scatter-gather transfer */
+typedef struct iovec {
+    uint8_t* base;
+    uint32_t len;
+} iovec_t;
+
 typedef struct fs_node {
     char name[128];
     uint32_t flags;
     uint32_t inode;
     uint32_t length;
     uint32_t impl; /* implementation defined number (e.g., start cluster) */
+    void* impl_data; /* implementation defined state (e.g., extent map) */
+    readahead_t ra; /* Sequential access tracking, one stream per reader */
+    struct pc_file* pages; /* Page cache state while the file has cached pages */
+    
+    /* Inode cache: nodes with a non-NULL 'fs' are shared and refcounted,
+     * keyed by (fs, inode). Unreferenced ones wait on an LRU list. */
+    void* fs;
+    uint32_t refcount;
+    struct fs_node* hash_next;
+    struct fs_node* lru_prev;
+    struct fs_node* lru_next;
     
     /* Function pointers for operations */
     uint32_t (*read)(struct fs_node*, uint32_t, uint32_t, uint8_t*);
     uint32_t (*write)(struct fs_node*, uint32_t, uint32_t, uint8_t*);
+    uint32_t (*readv)(struct fs_node*, uint32_t offset, const iovec_t* iov, uint32_t count);
+    uint32_t (*writev)(struct fs_node*, uint32_t offset, const iovec_t* iov, uint32_t count);
+    void (*prefetch)(struct fs_node*, uint32_t offset, uint32_t size); /* Queue I/O, don't wait */
     void (*open)(struct fs_node*);
     void (*close)(struct fs_node*);
     struct dirent* (*readdir)(struct fs_node*, uint32_t);
+    /* Copy up to 'max' entries starting at *pos into 'out', advancing *pos.
+     * Returns the number copied (0 at the end). */
+    uint32_t (*readdir_batch)(struct fs_node*, uint32_t* pos, struct dirent* out, uint32_t max);
     struct fs_node* (*finddir)(struct fs_node*, char* name);
+    const uint8_t* (*map)(struct fs_node*, uint32_t offset, uint32_t size);
+    void (*release)(struct fs_node*); /* Free fs state, node is leaving the cache */
+    
+    /* Namespace changes (on directories) and resizing (on files) */
+    struct fs_node* (*create)(struct fs_node*, char* name, uint32_t type);
+    int (*unlink)(struct fs_node*, char* name);
+    int (*truncate)(struct fs_node*, uint32_t length);
 } fs_node_t;
 
+/* Open directory stream; the position is whatever the filesystem uses to resume */
+typedef struct vfs_dir {
+    fs_node_t* node;
+    uint32_t pos;
+} vfs_dir_t;
+
+/* Asynchronous read request status */
+#define VFS_AIO_PENDING     1
+#define VFS_AIO_DONE        0
+#define VFS_AIO_ERROR       (-1)
+
+/* Caller-owned asynchronous read; must stay valid until 'complete' runs */
+typedef struct vfs_aio {
+    fs_node_t* node;
+    uint32_t offset;
+    const iovec_t* iov;
+    uint32_t iov_count;
+    void (*complete)(struct vfs_aio* req);  /* May be NULL */
+    void* ctx;                              /* For the completion callback */
+    
+    /* Filled in by the VFS */
+    uint32_t result;                        /* Bytes transferred */
+    int status;
+    struct vfs_aio* next;
+} vfs_aio_t;
+
 /* Global Root Node */
 extern fs_node_t* fs_root;
 
 /* Standard VFS calls */
 uint32_t vfs_read(fs_node_t* node, uint32_t offset, uint32_t size, uint8_t* buffer);
 uint32_t vfs_write(fs_node_t* node, uint32_t offset, uint32_t size, uint8_t* buffer);
-void vfs_open(fs_node_t* node);
-void vfs_close(fs_node_t* node);
+uint32_t vfs_readv(fs_node_t* node, uint32_t offset, const iovec_t* iov, uint32_t count);
+uint32_t vfs_writev(fs_node_t* node, uint32_t offset, const iovec_t* iov, uint32_t count);
+void vfs_open(fs_node_t* node);     /* Take a reference */
+void vfs_close(fs_node_t* node);    /* Drop a reference */
 dirent_t* vfs_readdir(fs_node_t* node, uint32_t index);
-fs_node_t* vfs_finddir(fs_node_t* node, char* name);
+fs_node_t* vfs_finddir(fs_node_t* node, char* name); /* Referenced: vfs_close it */
+
+/* Directory streams: each batch resumes where the previous one stopped */
+vfs_dir_t* vfs_opendir(fs_node_t* node);
+uint32_t vfs_readdir_batch(vfs_dir_t* dir, dirent_t* out, uint32_t max);
+void vfs_closedir(vfs_dir_t* dir);
+
+/* Queue a read and return at once. The filesystem queues the device I/O
+ * without waiting for it; vfs_aio_poll(), which the idle loops call,
+ * dispatches it and then does the copy and the completion. The request
+ * holds a reference to the node. */
+int vfs_read_async(vfs_aio_t* req);
+uint32_t vfs_aio_poll(void);    /* Complete queued requests, returns how many */
+int vfs_aio_wait(vfs_aio_t* req);
+
+/* Resolve "/a/b/c" (or "a/b/c", from the root), crossing mount points.
+ * Returns a referenced node: vfs_close it. */
+fs_node_t* vfs_lookup_path(const char* path);
+
+/* Resolve everything but the last component; that is copied to 'name'
+ * (VFS_NAME_MAX + 1 bytes). Returns the referenced parent directory. */
+fs_node_t* vfs_lookup_parent(const char* path, char* name);
+
+/* Create a file or directory (type FS_FILE / FS_DIRECTORY); returns it referenced */
+fs_node_t* vfs_create(fs_node_t* dir, char* name, uint32_t type);
+int vfs_unlink(fs_node_t* dir, char* name);
+int vfs_truncate(fs_node_t* node, uint32_t length);
+
+/* Attach a filesystem root at a directory ("/" replaces fs_root) */
+int vfs_mount(const char* path, fs_node_t* root);
+int vfs_umount(const char* path);
+
+/* Inode cache, used by filesystem drivers */
+fs_node_t* vfs_icache_get(void* fs, uint32_t inode);   /* Referenced node or NULL */
+void vfs_icache_add(fs_node_t* node);                  /* Node gets its first reference */
+void vfs_node_get(fs_node_t* node);                    /* Reference without opening */
+void vfs_node_put(fs_node_t* node);
+void vfs_icache_forget(fs_node_t* node);   /* Gone from disk: never hand it out again */
+
+/* Read-only pointer to file bytes [offset, offset+size), or NULL if the
+ * filesystem can't expose them in place. Valid until the file changes. */
+const uint8_t* vfs_map(fs_node_t* node, uint32_t offset, uint32_t size);
 
 #endif
@@ -0,0 +1,72 @@
+/**
+ * OpenWare OS - Block Buffer Cache
+ * Copyright (c) 2026 Ventryx Inc. All rights reserved.
+ *
+ * Sector-sized buffers keyed by (device, LBA), hashed for lookup and kept
+ * on an LRU list for eviction. Writes are deferred until bcache_sync() or
+ * until a dirty buffer is evicted.
+ */
+
+#ifndef BCACHE_H
+#define BCACHE_H
+
+#include "types.h"
+#include "blockdev.h"
+
+#define BCACHE_BLOCK_SIZE       512
+#define BCACHE_DEFAULT_BUFFERS  512     /* 256KB of cached sectors */
+#define BCACHE_HASH_BUCKETS     256     /* Must be a power of two */
+
+/* Buffer flags */
+#define BUF_VALID       0x01    /* Data matches (or supersedes) the device */
+#define BUF_DIRTY       0x02    /* Must be written back before reuse */
+#define BUF_READAHEAD   0x04    /* Prefetched and not used yet */
+
+typedef struct buf {
+    blockdev_t* dev;
+    uint32_t lba;
+    uint32_t flags;
+    uint32_t refcount;
+    uint8_t* data;
+    struct buf* hash_next;
+    struct buf* lru_prev;   /* Most recently used at the head */
+    struct buf* lru_next;
+} buf_t;
+
+typedef struct {
+    uint32_t buffers;
+    uint32_t in_use;        /* Buffers with a non-zero refcount */
+    uint32_t dirty;
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t evictions;
+    uint32_t writebacks;    /* Sectors written back to devices */
+    uint32_t ra_issued;     /* Sectors prefetched */
+    uint32_t ra_hits;       /* Prefetched sectors that were later used */
+} bcache_stats_t;
+
+int bcache_init(uint32_t buffers);
+
+/* Reference-counted buffer handles */
+buf_t* bcache_get(blockdev_t* dev, uint32_t lba);      /* Read through the cache */
+buf_t* bcache_get_noread(blockdev_t* dev, uint32_t lba); /* Caller overwrites whole sector */
+void bcache_mark_dirty(buf_t* buf);
+void bcache_release(buf_t* buf);
+
+/* Multi-sector copies through the cache */
+int bcache_read(blockdev_t* dev, uint32_t lba, uint32_t count, uint8_t* buffer);
+int bcache_write(blockdev_t* dev, uint32_t lba, uint32_t count, const uint8_t* buffer);
+
+/* Asynchronous read-ahead into the cache */
+void bcache_prefetch(blockdev_t* dev, uint32_t lba, uint32_t count);
+
+/* Write back dirty buffers in ascending LBA order (dev == NULL: all devices) */
+int bcache_sync(blockdev_t* dev);
+
+/* Write back just the dirty buffers in [lba, lba + count), e.g. before
+ * reading those sectors around the cache */
+int bcache_sync_range(blockdev_t* dev, uint32_t lba, uint32_t count);
+void bcache_invalidate(blockdev_t* dev);
+void bcache_get_stats(bcache_stats_t* stats);
+
+#endif
@@ -0,0 +1,88 @@
+/**
+ * OpenWare OS - Block Request Queue
+ * Copyright (c) 2026 Ventryx Inc. All rights reserved.
+ *
+ * Per-device queue of pending requests. Adjacent requests are merged into
+ * one driver call and dispatch follows a C-LOOK elevator (ascending LBA
+ * from the last head position, then wrap to the lowest). While a queue is
+ * plugged, submissions only accumulate; unplugging dispatches the batch.
+ *
+ * The drivers are polled, so "dispatch" completes the I/O before it
+ * returns: completion callbacks run from blkq_unplug()/blkq_run(), or from
+ * blkq_submit() itself when the queue isn't plugged. Work that nobody is
+ * waiting for (prefetches) can be left queued with blkq_unplug_deferred();
+ * it goes out with the device's next dispatch or from blkq_poll().
+ */
+
+#ifndef BLKQUEUE_H
+#define BLKQUEUE_H
+
+#include "types.h"
+#include "blockdev.h"
+
+#define BLKQ_READ               0
+#define BLKQ_WRITE              1
+
+#define BLKQ_MAX_MERGE_SECTORS  128     /* 64KB per merged driver call */
+#define BLKQ_MAX_DEPTH          64      /* Auto-unplug threshold */
+#define BLKQ_HIST_BUCKETS       16      /* log2 buckets */
+
+/* Request status */
+#define BLKQ_PENDING            1
+#define BLKQ_DONE               0
+#define BLKQ_ERROR              (-1)
+
+struct blk_request;
+typedef void (*blk_complete_t)(struct blk_request* req);
+
+typedef struct blk_request {
+    uint32_t op;                    /* BLKQ_READ / BLKQ_WRITE */
+    uint32_t lba;
+    uint32_t count;
+    uint8_t* buffer;
+    volatile int status;
+    blk_complete_t complete;        /* May be NULL */
+    void* ctx;                      /* For the completion callback */
+
+    /* Queue internals */
+    uint64_t submit_tsc;
+    uint32_t group_count;           /* Leader only: sectors covered by the merge group */
+    struct blk_request* next;       /* Next group in elevator order */
+    struct blk_request* merge_next; /* Next member of this merge group, ascending LBA */
+} blk_request_t;
+
+typedef struct {
+    uint32_t submitted;
+    uint32_t merged;                /* Requests folded into another one */
+    uint32_t dispatched;            /* Driver calls issued */
+    uint32_t depth;                 /* Currently queued requests */
+    uint32_t depth_hist[BLKQ_HIST_BUCKETS];     /* Queue depth seen at dispatch */
+    uint32_t latency_hist[BLKQ_HIST_BUCKETS];   /* Submit-to-complete, log2(cycles / 1024) */
+} blkq_stats_t;
+
+typedef struct blk_queue {
+    blockdev_t* dev;
+    blk_request_t* head;            /* Sorted by LBA */
+    uint32_t plugged;               /* Nesting count */
+    uint32_t head_pos;              /* LBA after the last dispatch */
+    bool running;
+    bool deferred;                  /* On the deferred list, waiting for blkq_poll */
+    struct blk_queue* deferred_next;
+    blkq_stats_t stats;
+} blk_queue_t;
+
+blk_queue_t* blkq_create(blockdev_t* dev);
+
+void blkq_submit(blockdev_t* dev, blk_request_t* req);
+void blkq_plug(blockdev_t* dev);
+void blkq_unplug(blockdev_t* dev);
+void blkq_unplug_deferred(blockdev_t* dev);     /* Leave the batch queued */
+uint32_t blkq_poll(void);                       /* Dispatch deferred batches */
+void blkq_run(blockdev_t* dev);
+
+/* Synchronous wrapper: submit and wait for completion */
+int blkq_rw_sync(blockdev_t* dev, uint32_t op, uint32_t lba, uint32_t count, uint8_t* buffer);
+
+bool blkq_get_stats(blockdev_t* dev, blkq_stats_t* stats);
+
+#endif
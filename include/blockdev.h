@@ -0,0 +1,58 @@
+/**
+ * OpenWare OS - Generic Block Device Layer
+ * Copyright (c) 2026 Ventryx Inc. All rights reserved.
+ *
+ * Every disk-like driver (ramdisk, ATA, ...) registers a blockdev_t here.
+ * Filesystems only ever talk to a blockdev_t, never to a driver directly.
+ */
+
+#ifndef BLOCKDEV_H
+#define BLOCKDEV_H
+
+#include "types.h"
+
+#define BLOCKDEV_NAME_LEN   16
+#define BLOCKDEV_MAX        8
+
+struct blk_queue;
+
+typedef struct blockdev {
+    char name[BLOCKDEV_NAME_LEN];
+    uint32_t sector_size;           /* Bytes per sector (512 for everything today) */
+    uint32_t sector_count;          /* Capacity in sectors */
+    void* priv;                     /* Driver private data */
+
+    /* Driver operations - return 0 on success, -1 on error */
+    int (*read)(struct blockdev*, uint32_t lba, uint32_t count, uint8_t* buffer);
+    int (*write)(struct blockdev*, uint32_t lba, uint32_t count, const uint8_t* buffer);
+    int (*flush)(struct blockdev*);
+
+    /* Optional: pointer to the sectors if the device is memory (DAX) */
+    uint8_t* (*direct_access)(struct blockdev*, uint32_t lba, uint32_t count);
+
+    struct blk_queue* queue;        /* Request queue (NULL: call the driver directly) */
+
+    /* Statistics */
+    uint32_t read_ops;
+    uint32_t write_ops;
+    uint32_t sectors_read;
+    uint32_t sectors_written;
+    uint32_t errors;
+} blockdev_t;
+
+/* Registry */
+int blockdev_register(blockdev_t* dev);
+blockdev_t* blockdev_find(const char* name);
+blockdev_t* blockdev_get(uint32_t index);
+uint32_t blockdev_count(void);
+
+/* I/O entry points used by filesystems */
+int blockdev_read(blockdev_t* dev, uint32_t lba, uint32_t count, uint8_t* buffer);
+int blockdev_write(blockdev_t* dev, uint32_t lba, uint32_t count, const uint8_t* buffer);
+int blockdev_flush(blockdev_t* dev);
+uint8_t* blockdev_direct_access(blockdev_t* dev, uint32_t lba, uint32_t count);
+
+/* Raw driver call used by the request queue (op is BLKQ_READ / BLKQ_WRITE) */
+int blockdev_do_io(blockdev_t* dev, uint32_t op, uint32_t lba, uint32_t count, uint8_t* buffer);
+
+#endif
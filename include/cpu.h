@@ -0,0 +1,41 @@
+/**
+ * OpenWare OS - CPU Feature Detection
+ * Copyright (c) 2026 Ventryx Inc. All rights reserved.
+ */
+
+#ifndef CPU_H
+#define CPU_H
+
+#include "types.h"
+
+/* CPUID leaf 1, EDX */
+#define CPUID_EDX_FXSR      (1 << 24)
+#define CPUID_EDX_SSE       (1 << 25)
+#define CPUID_EDX_SSE2      (1 << 26)
+
+/* Control register bits */
+#define CR0_MP              (1 << 1)
+#define CR0_EM              (1 << 2)
+#define CR4_OSFXSR          (1 << 9)
+#define CR4_OSXMMEXCPT      (1 << 10)
+
+/*
+ * Marks a function that may use SSE2. The compiler only emits SSE code
+ * inside such functions, and they realign the stack because our callers
+ * don't keep it 16-byte aligned. Call them only if cpu_has_sse2().
+ */
+#define CPU_SSE2_FN __attribute__((target("sse2"), force_align_arg_pointer))
+
+/* Detect features and turn on SSE if the CPU has it */
+void cpu_init(void);
+
+bool cpu_has_sse2(void);
+
+/* Time stamp counter, in CPU clock cycles */
+static inline uint64_t cpu_rdtsc(void) {
+    uint32_t lo, hi;
+    __asm__ volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+#endif
@@ -0,0 +1,18 @@
+/**
+ * OpenWare OS - LZ4 Block Decompressor
+ * Copyright (c) 2026 Ventryx Inc. All rights reserved.
+ */
+
+#ifndef LZ4_H
+#define LZ4_H
+
+#include "types.h"
+
+/*
+ * Decompress one raw LZ4 block (no frame header).
+ * Returns the number of bytes written to dst, or -1 if the input is
+ * malformed or would overflow dst_len.
+ */
+int lz4_decompress(const uint8_t* src, uint32_t src_len, uint8_t* dst, uint32_t dst_len);
+
+#endif
@@ -19,10 +19,17 @@ typedef struct alloc_block {
     struct alloc_block* next;
 } alloc_block_t;
 
+/* Called when an allocation fails: free up to 'wanted' bytes of cached
+ * data (kfree only, never kmalloc) and return how many were released. */
+typedef size_t (*mem_shrinker_t)(size_t wanted);
+
+#define MEMORY_MAX_SHRINKERS 4
+
 void memory_init(void);
 void* kmalloc(size_t size);
 void kfree(void* ptr);
 void* kcalloc(size_t num, size_t size);
+int memory_register_shrinker(mem_shrinker_t shrinker);
 void* kmemcpy(void* dest, const void* src, size_t n);
 void* kmemset(void* s, int c, size_t n);
 
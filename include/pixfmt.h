@@ -0,0 +1,34 @@
+/**
+ * OpenWare OS - Framebuffer Pixel Formats
+ * Copyright (c) 2026 Ventryx Inc. All rights reserved.
+ *
+ * Drawing code works with 0x00RRGGBB colors. A pixel format converts them
+ * to what the framebuffer stores and supplies the row kernels for that
+ * layout. The common layouts get kernels with the layout fixed at compile
+ * time; anything else falls back to kernels that shift by the field sizes
+ * and positions from the mode info.
+ */
+
+#ifndef PIXFMT_H
+#define PIXFMT_H
+
+#include "types.h"
+#include "vbe.h"
+
+typedef struct pixfmt {
+    const char* name;
+    uint32_t bytes;                                         /* Per pixel */
+    bool direct;                                            /* Pixels are 0x00RRGGBB */
+    uint32_t (*encode)(uint32_t color);                     /* 0x00RRGGBB to a pixel */
+    void (*put)(uint8_t* dst, uint32_t pixel);
+    void (*fill)(uint8_t* dst, uint32_t pixel, uint32_t n);
+    void (*blit)(uint8_t* dst, const uint32_t* src, uint32_t n);    /* From 0x00RRGGBB */
+    void (*read)(uint32_t* dst, const uint8_t* src, uint32_t n);    /* To 0x00RRGGBB */
+    /* Set the pixels j in [c0, c1) whose bit (0x80 >> j) is set in 'bits' */
+    void (*glyph)(uint8_t* dst, uint8_t bits, int c0, int c1, uint32_t pixel);
+} pixfmt_t;
+
+/* Format of a video mode, NULL if we can't draw in it (palette modes) */
+const pixfmt_t* pixfmt_select(const vbe_mode_info_t* mode);
+
+#endif
@@ -0,0 +1,43 @@
+/**
+ * OpenWare OS - Screen Regions
+ * Copyright (c) 2026 Ventryx Inc. All rights reserved.
+ *
+ * Small sets of screen rectangles. A region is either a damage list, which
+ * may grow to cover more than was added when it runs out of room, or an
+ * exact set of disjoint rectangles used to work out what is visible.
+ */
+
+#ifndef REGION_H
+#define REGION_H
+
+#include "types.h"
+#include "vbe.h"
+
+#define REGION_MAX  32      /* Rectangles per region */
+
+typedef struct {
+    vbe_rect_t rects[REGION_MAX];
+    int count;
+} region_t;
+
+static inline void region_clear(region_t* region) {
+    region->count = 0;
+}
+
+/* Intersection of a and b in 'out'; false if they don't overlap */
+bool rect_intersect(const vbe_rect_t* a, const vbe_rect_t* b, vbe_rect_t* out);
+
+/*
+ * Add an area to a damage list. Overlapping or touching rectangles are
+ * merged when that costs no extra pixels; once the list is full the area
+ * is folded into the rectangle it grows the least.
+ */
+void region_add(region_t* region, const vbe_rect_t* rect);
+
+/*
+ * Remove an area from a region of disjoint rectangles, keeping it exact.
+ * Returns false (region unchanged) if the pieces would not fit.
+ */
+bool region_subtract(region_t* region, const vbe_rect_t* rect);
+
+#endif
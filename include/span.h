@@ -0,0 +1,39 @@
+/**
+ * OpenWare OS - Pixel Span Operations
+ * Copyright (c) 2026 Ventryx Inc. All rights reserved.
+ *
+ * Row-level fills and copies of pixels, the inner loops of the 2D layer.
+ * Each has an SSE2 path used when the CPU supports it and a
+ * string-instruction fallback.
+ */
+
+#ifndef SPAN_H
+#define SPAN_H
+
+#include "types.h"
+
+/* Set 'n' pixels to 'color' */
+void span_fill32(uint32_t* dst, uint32_t color, uint32_t n);
+
+/* Copy 'n' pixels; the spans must not overlap */
+void span_copy32(uint32_t* dst, const uint32_t* src, uint32_t n);
+
+/* Copy 'n' pixels; the spans may overlap */
+void span_move32(uint32_t* dst, const uint32_t* src, uint32_t n);
+
+/*
+ * Alpha blending onto 0x00RRGGBB pixels. The alpha in the top byte of the
+ * source runs from 0 (dst unchanged) to 255 (src replaces dst); the result
+ * has a zero top byte.
+ */
+/* One color, with one alpha, over 'n' pixels */
+void span_blend_fill32(uint32_t* dst, uint32_t color, uint32_t n);
+
+/* 'n' 0xAARRGGBB pixels, each with its own alpha */
+void span_blend32(uint32_t* dst, const uint32_t* src, uint32_t n);
+
+/* Byte counts of any size, for pixels narrower than 32 bits */
+void span_copy(void* dst, const void* src, uint32_t bytes);
+void span_move(void* dst, const void* src, uint32_t bytes);
+
+#endif
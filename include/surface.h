@@ -0,0 +1,28 @@
+/**
+ * OpenWare OS - Off-screen Surfaces
+ * Copyright (c) 2026 Ventryx Inc. All rights reserved.
+ *
+ * Heap-backed pixel buffers in 0x00RRGGBB, one row after another with no
+ * padding. Windows draw into their own surface and the compositor copies
+ * the visible parts to the screen with vbe_blit.
+ */
+
+#ifndef SURFACE_H
+#define SURFACE_H
+
+#include "types.h"
+
+typedef struct {
+    int w, h;
+    uint32_t* pixels;           /* w * h pixels, stride w */
+} surface_t;
+
+/* New surface of w x h pixels (contents undefined); NULL if out of memory */
+surface_t* surface_create(int w, int h);
+void surface_destroy(surface_t* surface);
+
+/* Drawing is clipped to the surface */
+void surface_fill_rect(surface_t* surface, int x, int y, int w, int h, uint32_t color);
+void surface_draw_string(surface_t* surface, int x, int y, const char* str, uint32_t color);
+
+#endif
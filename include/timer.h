@@ -0,0 +1,31 @@
+/**
+ * OpenWare OS - Programmable Interval Timer
+ * Copyright (c) 2026 Ventryx Inc. All rights reserved.
+ *
+ * PIT channel 0 on IRQ0 as the system tick. One hook runs on every tick
+ * in interrupt context, so it must only record state.
+ */
+
+#ifndef TIMER_H
+#define TIMER_H
+
+#include "types.h"
+
+#define PIT_CHANNEL0        0x40
+#define PIT_COMMAND         0x43
+#define PIT_BASE_HZ         1193182
+#define PIT_MODE_RATE       0x34        /* Channel 0, low then high byte, mode 2 */
+
+#define TIMER_HZ            1000        /* Ticks per second */
+
+typedef void (*timer_hook_t)(void);
+
+void timer_init(uint32_t hz);
+uint32_t timer_ticks(void);
+uint32_t timer_get_hz(void);
+void timer_set_hook(timer_hook_t hook);
+
+/* TSC cycles per microsecond, timed over the first second of ticks (0 until then) */
+uint32_t timer_tsc_per_us(void);
+
+#endif
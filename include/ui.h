@@ -2,23 +2,33 @@
 #define UI_H
 
 #include <stdint.h>
-#include <stdbool.h>
+#include "types.h"
 #include "vbe.h"
+#include "surface.h"
 
 #define MAX_WINDOWS 32
 
+#define UI_BACKGROUND       0x00003366
+#define UI_SHADOW_COLOR     0x60000000      // Black at 3/8 opacity
+#define UI_SHADOW_OFFSET    4           // Shadow drawn down and right of the window
+#define UI_TITLE_COLOR      0x00336699
+#define UI_TITLE_HEIGHT     18
+
 typedef struct {
     int x, y, w, h;
     uint32_t color;
     const char* title;
     bool visible;
     bool dragging;
-    // Buffer for window content (optional for now, can draw direct)
+    surface_t* surface;         // Frame and content, w x h, composited to the screen
+    bool content_dirty;         // Surface must be redrawn before the next frame
 } window_t;
 
 void ui_init(void);
 void ui_render(void);
+void ui_update(void);
 int ui_create_window(int x, int y, int w, int h, const char* title, uint32_t color);
+void ui_invalidate_window(int id);
 void ui_handle_mouse(int x, int y, bool clicked);
 
 #endif // UI_H
@@ -34,7 +34,55 @@ typedef struct {
 } __attribute__((packed)) vbe_mode_info_t;
 
 /**
- * Common Colors (32-bit ARGB)
+ * Screen rectangle (used for damage tracking)
+ */
+typedef struct {
+    int x, y, w, h;
+} vbe_rect_t;
+
+/**
+ * Frame pacing counters
+ */
+typedef struct {
+    uint32_t refresh_hz;        // 0: unpaced
+    uint32_t frames;            // Frames that fell due
+    uint32_t presented;         // Swaps that had something to show
+    uint32_t dropped;           // Frames missed with damage still waiting
+    uint32_t timed;             // Presents timed (once the TSC is calibrated)
+    uint32_t present_us_last;
+    uint32_t present_us_max;
+    uint32_t present_us_total;
+} vbe_frame_stats_t;
+
+#define VBE_GLYPH_SLOTS 4       // Foreground/background pairs kept pre-expanded
+#define VBE_BLEND_CHUNK 256     // Pixels converted per step when blending in other formats
+#define VBE_CURSOR_W    12      // Pointer sprite size, hot spot at the top left
+#define VBE_CURSOR_H    19
+#define VBE_REFRESH_HZ  60      // Default frame rate once the timer runs
+
+/**
+ * Bochs/QEMU VBE extension (DISPI) registers, used to move the display
+ * start within video memory for hardware scrolling and page flipping
+ */
+#define VBE_DISPI_IOPORT_INDEX      0x01CE
+#define VBE_DISPI_IOPORT_DATA       0x01CF
+
+#define VBE_DISPI_INDEX_ID          0x0
+#define VBE_DISPI_INDEX_XRES        0x1
+#define VBE_DISPI_INDEX_YRES        0x2
+#define VBE_DISPI_INDEX_BPP         0x3
+#define VBE_DISPI_INDEX_ENABLE      0x4
+#define VBE_DISPI_INDEX_VIRT_WIDTH  0x6
+#define VBE_DISPI_INDEX_VIRT_HEIGHT 0x7
+#define VBE_DISPI_INDEX_X_OFFSET    0x8
+#define VBE_DISPI_INDEX_Y_OFFSET    0x9
+
+#define VBE_DISPI_ID0               0xB0C0  // Oldest interface revision
+#define VBE_DISPI_ID5               0xB0C5  // Newest known revision
+#define VBE_DISPI_ENABLED           0x01
+
+/**
+ * Common Colors (32-bit ARGB; the alpha byte only matters to the blend calls)
  */
 #define COLOR_BLACK     0x00000000
 #define COLOR_WHITE     0x00FFFFFF
@@ -50,15 +98,34 @@ typedef struct {
  * Function prototypes
  */
 void vbe_init(void);
+int vbe_get_width(void);
+int vbe_get_height(void);
 void vbe_putpixel(int x, int y, uint32_t color);
 void vbe_clear(uint32_t color);
 void vbe_draw_rect(int x, int y, int w, int h, uint32_t color);
+void vbe_hline(int x, int y, int w, uint32_t color);
+void vbe_vline(int x, int y, int h, uint32_t color);
+void vbe_blit(int x, int y, const uint32_t* src, int stride, int w, int h);
+void vbe_copy_rect(int sx, int sy, int dx, int dy, int w, int h);
+void vbe_blend_rect(int x, int y, int w, int h, uint32_t color);
+void vbe_blend_blit(int x, int y, const uint32_t* src, int stride, int w, int h);
+void vbe_set_clip(int x, int y, int w, int h);
+void vbe_reset_clip(void);
 void vbe_draw_line(int x0, int y0, int x1, int y1, uint32_t color);
 void vbe_enable_double_buffering(void);
 void vbe_swap(void);
+void vbe_present(void);
+int vbe_frame_ready(void);
+void vbe_frame_tick(void);
+void vbe_set_refresh(int hz);
+void vbe_get_frame_stats(vbe_frame_stats_t* stats);
+void vbe_mark_dirty(int x, int y, int w, int h);
 void vbe_draw_char(int x, int y, char c, uint32_t color);
 void vbe_draw_string(int x, int y, const char* str, uint32_t color);
+void vbe_draw_text(int x, int y, const char* str, uint32_t fg, uint32_t bg);
 void vbe_print(const char* str, uint32_t color);
+void vbe_set_cursor(int x, int y);
+void vbe_show_cursor(int visible);
 
 
 
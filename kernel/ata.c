@@ -5,6 +5,11 @@
 
 #include "ata.h"
 #include "vga.h"
+#include "../include/blockdev.h"
+#include "../include/memory.h"
+
+static blockdev_t ata_dev;
+static uint16_t identify_data[256];
 
 /* Helper for port I/O */
 static inline uint8_t inb(uint16_t port) {
@@ -35,27 +40,121 @@ static void ata_wait_io(void) {
     inb(ATA_PRIMARY_STATUS);
 }
 
-/* Poll status */
-static void ata_wait_busy(void) {
-    while (inb(ATA_PRIMARY_STATUS) & ATA_SR_BSY);
+/* Poll status until BSY clears: 0, or -1 on timeout or a reported error */
+static int ata_wait_busy(void) {
+    uint8_t status;
+    uint32_t timeout = ATA_TIMEOUT;
+    do {
+        status = inb(ATA_PRIMARY_STATUS);
+    } while ((status & ATA_SR_BSY) && --timeout);
+    if (timeout == 0 || (status & (ATA_SR_ERR | ATA_SR_DF))) return -1;
+    return 0;
+}
+
+/* Wait until the drive is ready to move a sector of data */
+static int ata_wait_drq(void) {
+    if (ata_wait_busy() != 0) return -1;
+    
+    uint8_t status;
+    uint32_t timeout = ATA_TIMEOUT;
+    do {
+        status = inb(ATA_PRIMARY_STATUS);
+    } while (!(status & (ATA_SR_DRQ | ATA_SR_ERR | ATA_SR_DF)) && --timeout);
+    if (timeout == 0 || (status & (ATA_SR_ERR | ATA_SR_DF))) return -1;
+    return 0;
+}
+
+/* Max sectors per PIO command (the count register is 8 bits, 0 means 256) */
+#define ATA_MAX_XFER 255
+
+static int ata_dev_read(blockdev_t* dev, uint32_t lba, uint32_t count, uint8_t* buffer) {
+    (void)dev;
+    while (count > 0) {
+        uint32_t chunk = count > ATA_MAX_XFER ? ATA_MAX_XFER : count;
+        if (ata_read_sectors(lba, (uint8_t)chunk, buffer) != 0) return -1;
+        lba += chunk;
+        count -= chunk;
+        buffer += chunk * 512;
+    }
+    return 0;
+}
+
+static int ata_dev_write(blockdev_t* dev, uint32_t lba, uint32_t count, const uint8_t* buffer) {
+    (void)dev;
+    while (count > 0) {
+        uint32_t chunk = count > ATA_MAX_XFER ? ATA_MAX_XFER : count;
+        if (ata_write_sectors(lba, (uint8_t)chunk, (uint8_t*)buffer) != 0) return -1;
+        lba += chunk;
+        count -= chunk;
+        buffer += chunk * 512;
+    }
+    return 0;
 }
 
-static void ata_wait_ready(void) {
-    while (!(inb(ATA_PRIMARY_STATUS) & ATA_SR_DRDY));
+static int ata_dev_flush(blockdev_t* dev) {
+    (void)dev;
+    if (ata_wait_busy() != 0) return -1;
+    outb(ATA_PRIMARY_COMMAND, ATA_CMD_CACHE_FLUSH);
+    return ata_wait_busy();
 }
 
 /**
  * Initialize ATA driver
+ * Identifies the primary master and registers it as block device "hda".
  */
 void ata_init(void) {
-    // Identify drive would go here
+    /* Floating bus - no controller present */
+    if (inb(ATA_PRIMARY_STATUS) == 0xFF) return;
+
+    outb(ATA_PRIMARY_DRIVE_HEAD, ATA_MASTER);
+    ata_wait_io();
+    outb(ATA_PRIMARY_SEC_COUNT, 0);
+    outb(ATA_PRIMARY_LBA_LO, 0);
+    outb(ATA_PRIMARY_LBA_MID, 0);
+    outb(ATA_PRIMARY_LBA_HI, 0);
+    outb(ATA_PRIMARY_COMMAND, ATA_CMD_IDENTIFY);
+
+    /* Status 0 means no drive */
+    if (inb(ATA_PRIMARY_STATUS) == 0) return;
+
+    uint32_t timeout = ATA_TIMEOUT;
+    while ((inb(ATA_PRIMARY_STATUS) & ATA_SR_BSY) && --timeout);
+    if (timeout == 0) return;
+
+    /* Non-zero signature means ATAPI/SATA, which PIO ATA can't drive */
+    if (inb(ATA_PRIMARY_LBA_MID) != 0 || inb(ATA_PRIMARY_LBA_HI) != 0) return;
+
+    uint8_t status;
+    timeout = ATA_TIMEOUT;
+    do {
+        status = inb(ATA_PRIMARY_STATUS);
+    } while (!(status & (ATA_SR_DRQ | ATA_SR_ERR)) && --timeout);
+    if (timeout == 0 || (status & ATA_SR_ERR)) return;
+
+    for (int i = 0; i < 256; i++) {
+        identify_data[i] = inw(ATA_PRIMARY_DATA);
+    }
+
+    /* Words 60-61: total addressable sectors in 28-bit LBA mode */
+    uint32_t sectors = identify_data[60] | ((uint32_t)identify_data[61] << 16);
+    if (sectors == 0) return;
+
+    kmemset(&ata_dev, 0, sizeof(blockdev_t));
+    kmemcpy(ata_dev.name, "hda", 4);
+    ata_dev.sector_size = 512;
+    ata_dev.sector_count = sectors;
+    ata_dev.read = ata_dev_read;
+    ata_dev.write = ata_dev_write;
+    ata_dev.flush = ata_dev_flush;
+
+    blockdev_register(&ata_dev);
 }
 
 /**
  * Read sectors using PIO mode (28-bit LBA)
  */
-void ata_read_sectors(uint32_t lba, uint8_t sectors, uint8_t* buffer) {
-    ata_wait_busy();
+int ata_read_sectors(uint32_t lba, uint8_t sectors, uint8_t* buffer) {
+    if (ata_wait_busy() != 0) return -1;
 
     outb(ATA_PRIMARY_DRIVE_HEAD, 0xE0 | ((lba >> 24) & 0x0F));
     outb(ATA_PRIMARY_ERROR, 0x00);
@@ -68,20 +167,20 @@ void ata_read_sectors(uint32_t lba, uint8_t sectors, uint8_t* buffer) {
     uint16_t* target = (uint16_t*)buffer;
 
     for (int i = 0; i < sectors; i++) {
-        ata_wait_busy();
-        ata_wait_ready();
+        if (ata_wait_drq() != 0) return -1;
 
         for (int j = 0; j < 256; j++) {
             target[j + (i * 256)] = inw(ATA_PRIMARY_DATA);
         }
     }
+    return 0;
 }
 
 /**
  * Write sectors using PIO mode
  */
-void ata_write_sectors(uint32_t lba, uint8_t sectors, uint8_t* buffer) {
-    ata_wait_busy();
+int ata_write_sectors(uint32_t lba, uint8_t sectors, uint8_t* buffer) {
+    if (ata_wait_busy() != 0) return -1;
 
     outb(ATA_PRIMARY_DRIVE_HEAD, 0xE0 | ((lba >> 24) & 0x0F));
     outb(ATA_PRIMARY_ERROR, 0x00);
@@ -94,15 +193,17 @@ void ata_write_sectors(uint32_t lba, uint8_t sectors, uint8_t* buffer) {
     uint16_t* target = (uint16_t*)buffer;
 
     for (int i = 0; i < sectors; i++) {
-        ata_wait_busy();
-        ata_wait_ready();
+        if (ata_wait_drq() != 0) return -1;
 
         for (int j = 0; j < 256; j++) {
             outw(ATA_PRIMARY_DATA, target[j + (i * 256)]);
         }
     }
     
+    // The last sector is only on the drive once BSY drops
+    if (ata_wait_busy() != 0) return -1;
+    
     // Cache flush command
     outb(ATA_PRIMARY_COMMAND, ATA_CMD_CACHE_FLUSH);
-    ata_wait_busy();
+    return ata_wait_busy();
 }
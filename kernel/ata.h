@@ -60,8 +60,12 @@
 #define ATA_SLAVE      0xB0
 
 void ata_init(void);
-void ata_read_sectors(uint32_t lba, uint8_t sectors, uint8_t* buffer);
-void ata_write_sectors(uint32_t lba, uint8_t sectors, uint8_t* buffer);
+/* Polls before giving up on the drive */
+#define ATA_TIMEOUT    100000
+
+/* Return 0 on success, -1 on a device error or timeout */
+int ata_read_sectors(uint32_t lba, uint8_t sectors, uint8_t* buffer);
+int ata_write_sectors(uint32_t lba, uint8_t sectors, uint8_t* buffer);
 void ata_soft_reset(void);
 
 #endif
@@ -0,0 +1,509 @@
+/**
+ * OpenWare OS - Block Buffer Cache
+ * Copyright (c) 2026 Ventryx Inc. All rights reserved.
+ */
+
+#include "bcache.h"
+#include "blkqueue.h"
+#include "memory.h"
+
+static buf_t* buffers = NULL;
+static uint8_t* buffer_data = NULL;
+static uint32_t buffer_count = 0;
+static uint32_t dirty_count = 0;
+static buf_t* hash_table[BCACHE_HASH_BUCKETS];
+
+/* LRU list: head is most recently used, tail is the eviction candidate */
+static buf_t* lru_head = NULL;
+static buf_t* lru_tail = NULL;
+
+static uint32_t stat_hits = 0;
+static uint32_t stat_misses = 0;
+static uint32_t stat_evictions = 0;
+static uint32_t stat_writebacks = 0;
+static uint32_t stat_ra_issued = 0;
+static uint32_t stat_ra_hits = 0;
+
+static uint32_t bcache_hash(blockdev_t* dev, uint32_t lba) {
+    uint32_t h = (lba ^ ((uint32_t)dev >> 4)) * 0x9E3779B1;
+    return (h ^ (h >> 16)) & (BCACHE_HASH_BUCKETS - 1);
+}
+
+static void lru_unlink(buf_t* buf) {
+    if (buf->lru_prev) buf->lru_prev->lru_next = buf->lru_next;
+    else lru_head = buf->lru_next;
+    if (buf->lru_next) buf->lru_next->lru_prev = buf->lru_prev;
+    else lru_tail = buf->lru_prev;
+    buf->lru_prev = buf->lru_next = NULL;
+}
+
+static void lru_push_front(buf_t* buf) {
+    buf->lru_prev = NULL;
+    buf->lru_next = lru_head;
+    if (lru_head) lru_head->lru_prev = buf;
+    lru_head = buf;
+    if (!lru_tail) lru_tail = buf;
+}
+
+static void lru_push_back(buf_t* buf) {
+    buf->lru_next = NULL;
+    buf->lru_prev = lru_tail;
+    if (lru_tail) lru_tail->lru_next = buf;
+    lru_tail = buf;
+    if (!lru_head) lru_head = buf;
+}
+
+static void hash_insert(buf_t* buf) {
+    uint32_t h = bcache_hash(buf->dev, buf->lba);
+    buf->hash_next = hash_table[h];
+    hash_table[h] = buf;
+}
+
+static void hash_remove(buf_t* buf) {
+    if (!buf->dev) return;
+    buf_t** link = &hash_table[bcache_hash(buf->dev, buf->lba)];
+    while (*link) {
+        if (*link == buf) {
+            *link = buf->hash_next;
+            break;
+        }
+        link = &(*link)->hash_next;
+    }
+    buf->hash_next = NULL;
+}
+
+static buf_t* hash_lookup(blockdev_t* dev, uint32_t lba) {
+    buf_t* buf = hash_table[bcache_hash(dev, lba)];
+    while (buf) {
+        if (buf->dev == dev && buf->lba == lba) return buf;
+        buf = buf->hash_next;
+    }
+    return NULL;
+}
+
+static int writeback(buf_t* buf) {
+    if (blockdev_write(buf->dev, buf->lba, 1, buf->data) != 0) return -1;
+    buf->flags &= ~BUF_DIRTY;
+    dirty_count--;
+    stat_writebacks++;
+    return 0;
+}
+
+/**
+ * Allocate the cache. Can be called again to resize; everything dirty is
+ * written back first.
+ */
+int bcache_init(uint32_t count) {
+    if (count == 0) return -1;
+
+    if (buffers) {
+        blkq_poll();    /* Deferred prefetches hold buffers */
+        bcache_sync(NULL);
+        for (uint32_t i = 0; i < buffer_count; i++) {
+            if (buffers[i].refcount) return -1;  /* Can't resize while handles are held */
+        }
+        kfree(buffer_data);
+        kfree(buffers);
+    }
+
+    buffers = (buf_t*)kcalloc(count, sizeof(buf_t));
+    buffer_data = (uint8_t*)kmalloc(count * BCACHE_BLOCK_SIZE);
+    if (!buffers || !buffer_data) {
+        kfree(buffers);
+        kfree(buffer_data);
+        buffers = NULL;
+        buffer_data = NULL;
+        buffer_count = 0;
+        return -1;
+    }
+
+    buffer_count = count;
+    dirty_count = 0;
+    lru_head = lru_tail = NULL;
+    for (uint32_t i = 0; i < BCACHE_HASH_BUCKETS; i++) hash_table[i] = NULL;
+
+    for (uint32_t i = 0; i < count; i++) {
+        buffers[i].data = buffer_data + i * BCACHE_BLOCK_SIZE;
+        lru_push_back(&buffers[i]);
+    }
+
+    stat_hits = stat_misses = stat_evictions = stat_writebacks = 0;
+    stat_ra_issued = stat_ra_hits = 0;
+    return 0;
+}
+
+/* Recycle the least recently used unreferenced buffer for (dev, lba).
+ * Returns it hashed, referenced once and not yet valid. */
+static buf_t* claim_buffer(blockdev_t* dev, uint32_t lba) {
+    buf_t* victim = lru_tail;
+    while (victim && victim->refcount) victim = victim->lru_prev;
+    if (!victim && blkq_poll() > 0) {
+        /* Deferred prefetches were holding buffers: finish them and retry */
+        victim = lru_tail;
+        while (victim && victim->refcount) victim = victim->lru_prev;
+    }
+    if (!victim) return NULL;
+
+    if (victim->flags & BUF_DIRTY) {
+        if (writeback(victim) != 0) return NULL;
+    }
+    if (victim->flags & BUF_VALID) stat_evictions++;
+
+    hash_remove(victim);
+    victim->dev = dev;
+    victim->lba = lba;
+    victim->flags = 0;
+    hash_insert(victim);
+
+    victim->refcount = 1;
+    lru_unlink(victim);
+    lru_push_front(victim);
+    return victim;
+}
+
+/* Give a buffer back to the free end of the LRU after a failed read */
+static void discard_buffer(buf_t* buf) {
+    hash_remove(buf);
+    buf->dev = NULL;
+    buf->flags = 0;
+    buf->refcount = 0;
+    lru_unlink(buf);
+    lru_push_back(buf);
+}
+
+/* Find (or recycle a buffer for) a sector; reads it only if asked to */
+static buf_t* bcache_lookup(blockdev_t* dev, uint32_t lba, bool read) {
+    if (!buffers || !dev || dev->sector_size != BCACHE_BLOCK_SIZE) return NULL;
+
+    buf_t* buf = hash_lookup(dev, lba);
+    if (buf) {
+        stat_hits++;
+        if (buf->flags & BUF_READAHEAD) {
+            stat_ra_hits++;
+            buf->flags &= ~BUF_READAHEAD;
+        }
+        buf->refcount++;
+        lru_unlink(buf);
+        lru_push_front(buf);
+
+        /* A prefetch still waiting in the queue: dispatch it (with whatever
+         * it merged with), or read the sector now if that can't happen */
+        if (read && !(buf->flags & BUF_VALID)) blkq_run(dev);
+        if (read && !(buf->flags & BUF_VALID)) {
+            if (blockdev_read(dev, lba, 1, buf->data) != 0) {
+                buf->refcount--;
+                return NULL;
+            }
+            buf->flags |= BUF_VALID;
+        }
+        return buf;
+    }
+
+    stat_misses++;
+
+    buf = claim_buffer(dev, lba);
+    if (!buf) return NULL;
+
+    if (read) {
+        if (blockdev_read(dev, lba, 1, buf->data) != 0) {
+            discard_buffer(buf);
+            return NULL;
+        }
+        buf->flags = BUF_VALID;
+    }
+    return buf;
+}
+
+/**
+ * Get a referenced buffer holding the sector contents
+ */
+buf_t* bcache_get(blockdev_t* dev, uint32_t lba) {
+    return bcache_lookup(dev, lba, true);
+}
+
+/**
+ * Get a referenced buffer without reading it from the device.
+ * The caller must overwrite the whole sector and mark it dirty.
+ */
+buf_t* bcache_get_noread(blockdev_t* dev, uint32_t lba) {
+    buf_t* buf = bcache_lookup(dev, lba, false);
+    if (buf) buf->flags |= BUF_VALID;
+    return buf;
+}
+
+void bcache_mark_dirty(buf_t* buf) {
+    if (!(buf->flags & BUF_DIRTY)) {
+        buf->flags |= BUF_DIRTY | BUF_VALID;
+        dirty_count++;
+    }
+}
+
+/**
+ * Drop a reference. Once too much of the cache is dirty, write it back
+ * so eviction doesn't degrade into one synchronous write per miss.
+ */
+void bcache_release(buf_t* buf) {
+    if (!buf || buf->refcount == 0) return;
+    buf->refcount--;
+
+    if (buf->refcount == 0 && dirty_count > buffer_count / 2) {
+        bcache_sync(NULL);
+    }
+}
+
+/**
+ * Copy sectors out of the cache, filling misses from the device.
+ * Consecutive misses are read with one device request straight into the
+ * caller's buffer, then copied into the cache.
+ */
+int bcache_read(blockdev_t* dev, uint32_t lba, uint32_t count, uint8_t* buffer) {
+    if (!buffers || !dev || dev->sector_size != BCACHE_BLOCK_SIZE) {
+        return blockdev_read(dev, lba, count, buffer);
+    }
+
+    uint32_t i = 0;
+    while (i < count) {
+        uint32_t run = 0;
+        while (i + run < count && !hash_lookup(dev, lba + i + run)) run++;
+
+        if (run == 0) {
+            buf_t* buf = bcache_get(dev, lba + i);
+            if (!buf) return -1;
+            kmemcpy(buffer + i * BCACHE_BLOCK_SIZE, buf->data, BCACHE_BLOCK_SIZE);
+            bcache_release(buf);
+            i++;
+            continue;
+        }
+
+        uint8_t* dst = buffer + i * BCACHE_BLOCK_SIZE;
+        if (blockdev_read(dev, lba + i, run, dst) != 0) return -1;
+
+        for (uint32_t k = 0; k < run; k++) {
+            stat_misses++;
+            buf_t* buf = claim_buffer(dev, lba + i + k);
+            if (!buf) break;    /* Everything pinned: just don't cache it */
+            kmemcpy(buf->data, dst + k * BCACHE_BLOCK_SIZE, BCACHE_BLOCK_SIZE);
+            buf->flags = BUF_VALID;
+            buf->refcount = 0;
+        }
+        i += run;
+    }
+    return 0;
+}
+
+/**
+ * Copy sectors into the cache and mark them dirty (write-back)
+ */
+int bcache_write(blockdev_t* dev, uint32_t lba, uint32_t count, const uint8_t* buffer) {
+    if (!buffers) return blockdev_write(dev, lba, count, buffer);
+
+    for (uint32_t i = 0; i < count; i++) {
+        buf_t* buf = bcache_get_noread(dev, lba + i);
+        if (!buf) return -1;
+        kmemcpy(buf->data, buffer + i * BCACHE_BLOCK_SIZE, BCACHE_BLOCK_SIZE);
+        bcache_mark_dirty(buf);
+        bcache_release(buf);
+    }
+    return 0;
+}
+
+/* Prefetches read into their own sector, so one that finishes after the
+ * buffer was filled (or overwritten) by someone else changes nothing */
+typedef struct {
+    blk_request_t req;
+    buf_t* buf;
+    uint8_t data[BCACHE_BLOCK_SIZE];
+} prefetch_t;
+
+static void prefetch_done(blk_request_t* req) {
+    prefetch_t* pf = (prefetch_t*)req->ctx;
+    buf_t* buf = pf->buf;
+
+    if (req->status == BLKQ_DONE) {
+        if (!(buf->flags & BUF_VALID)) {
+            kmemcpy(buf->data, pf->data, BCACHE_BLOCK_SIZE);
+            buf->flags |= BUF_VALID | BUF_READAHEAD;
+        }
+        buf->refcount--;
+    } else if (buf->refcount == 1 && !(buf->flags & BUF_VALID)) {
+        discard_buffer(buf);
+    } else {
+        buf->refcount--;
+    }
+    kfree(pf);
+}
+
+/**
+ * Start reading sectors that aren't cached yet, without waiting.
+ * Missing sectors are queued as one batch so the queue merges them into
+ * as few device requests as possible. The batch is dispatched with the
+ * device's next request, when a reader needs one of the sectors, or from
+ * blkq_poll().
+ */
+void bcache_prefetch(blockdev_t* dev, uint32_t lba, uint32_t count) {
+    if (!buffers || !dev || dev->sector_size != BCACHE_BLOCK_SIZE) return;
+    if (lba >= dev->sector_count) return;
+    if (count > dev->sector_count - lba) count = dev->sector_count - lba;
+
+    /* Never let read-ahead push out more than a quarter of the cache */
+    if (count > buffer_count / 4) count = buffer_count / 4;
+
+    blkq_plug(dev);
+    for (uint32_t i = 0; i < count; i++) {
+        if (hash_lookup(dev, lba + i)) continue;
+
+        prefetch_t* pf = (prefetch_t*)kmalloc(sizeof(prefetch_t));
+        if (!pf) break;
+
+        buf_t* buf = claim_buffer(dev, lba + i);
+        if (!buf) {
+            kfree(pf);
+            break;
+        }
+
+        pf->buf = buf;
+        pf->req.op = BLKQ_READ;
+        pf->req.lba = lba + i;
+        pf->req.count = 1;
+        pf->req.buffer = pf->data;
+        pf->req.complete = prefetch_done;
+        pf->req.ctx = pf;
+        stat_ra_issued++;
+        blkq_submit(dev, &pf->req);
+    }
+    blkq_unplug_deferred(dev);
+}
+
+/* Order for write-back: group by device, then ascending LBA */
+static bool buf_before(buf_t* a, buf_t* b) {
+    if (a->dev != b->dev) return (uint32_t)a->dev < (uint32_t)b->dev;
+    return a->lba < b->lba;
+}
+
+static void writeback_done(blk_request_t* req) {
+    buf_t* buf = (buf_t*)req->ctx;
+    if (req->status == BLKQ_DONE && (buf->flags & BUF_DIRTY)) {
+        buf->flags &= ~BUF_DIRTY;
+        dirty_count--;
+        stat_writebacks++;
+    }
+}
+
+/**
+ * Write back dirty buffers sorted by LBA, then flush the device caches.
+ * Each device's batch is submitted plugged so adjacent sectors go out
+ * as merged requests.
+ */
+int bcache_sync(blockdev_t* dev) {
+    if (!buffers || dirty_count == 0) return 0;
+
+    buf_t** list = (buf_t**)kmalloc(dirty_count * sizeof(buf_t*));
+    blk_request_t* reqs = (blk_request_t*)kmalloc(dirty_count * sizeof(blk_request_t));
+    if (!list || !reqs) {
+        kfree(list);
+        kfree(reqs);
+        return -1;
+    }
+
+    uint32_t n = 0;
+    for (uint32_t i = 0; i < buffer_count && n < dirty_count; i++) {
+        buf_t* buf = &buffers[i];
+        if ((buf->flags & BUF_DIRTY) && (!dev || buf->dev == dev)) list[n++] = buf;
+    }
+
+    /* Insertion sort - the list is small and often nearly sorted */
+    for (uint32_t i = 1; i < n; i++) {
+        buf_t* key = list[i];
+        uint32_t j = i;
+        while (j > 0 && buf_before(key, list[j - 1])) {
+            list[j] = list[j - 1];
+            j--;
+        }
+        list[j] = key;
+    }
+
+    int result = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        blockdev_t* target = list[i]->dev;
+        if (i == 0 || list[i - 1]->dev != target) blkq_plug(target);
+
+        reqs[i].op = BLKQ_WRITE;
+        reqs[i].lba = list[i]->lba;
+        reqs[i].count = 1;
+        reqs[i].buffer = list[i]->data;
+        reqs[i].complete = writeback_done;
+        reqs[i].ctx = list[i];
+        blkq_submit(target, &reqs[i]);
+
+        if (i + 1 == n || list[i + 1]->dev != target) {
+            blkq_unplug(target);
+            blockdev_flush(target);
+        }
+    }
+
+    for (uint32_t i = 0; i < n; i++) {
+        if (reqs[i].status != BLKQ_DONE) result = -1;
+    }
+
+    kfree(reqs);
+    kfree(list);
+    return result;
+}
+
+/**
+ * Write back the dirty buffers of a sector range. Short ranges are looked
+ * up sector by sector, long ones by walking the buffers.
+ */
+int bcache_sync_range(blockdev_t* dev, uint32_t lba, uint32_t count) {
+    if (!buffers || dirty_count == 0) return 0;
+
+    int result = 0;
+    if (count <= buffer_count) {
+        for (uint32_t i = 0; i < count && dirty_count > 0; i++) {
+            buf_t* buf = hash_lookup(dev, lba + i);
+            if (buf && (buf->flags & BUF_DIRTY) && writeback(buf) != 0) result = -1;
+        }
+        return result;
+    }
+
+    for (uint32_t i = 0; i < buffer_count && dirty_count > 0; i++) {
+        buf_t* buf = &buffers[i];
+        if (buf->dev == dev && (buf->flags & BUF_DIRTY) &&
+            buf->lba >= lba && buf->lba - lba < count && writeback(buf) != 0) result = -1;
+    }
+    return result;
+}
+
+/**
+ * Forget every unreferenced buffer of a device (after writing it back)
+ */
+void bcache_invalidate(blockdev_t* dev) {
+    if (!buffers) return;
+    bcache_sync(dev);
+
+    for (uint32_t i = 0; i < buffer_count; i++) {
+        buf_t* buf = &buffers[i];
+        if (buf->dev == dev && buf->refcount == 0 && !(buf->flags & BUF_DIRTY)) {
+            hash_remove(buf);
+            buf->dev = NULL;
+            buf->flags = 0;
+            lru_unlink(buf);
+            lru_push_back(buf);
+        }
+    }
+}
+
+void bcache_get_stats(bcache_stats_t* stats) {
+    stats->buffers = buffer_count;
+    stats->in_use = 0;
+    for (uint32_t i = 0; i < buffer_count; i++) {
+        if (buffers[i].refcount) stats->in_use++;
+    }
+    stats->dirty = dirty_count;
+    stats->hits = stat_hits;
+    stats->misses = stat_misses;
+    stats->evictions = stat_evictions;
+    stats->writebacks = stat_writebacks;
+    stats->ra_issued = stat_ra_issued;
+    stats->ra_hits = stat_ra_hits;
+}
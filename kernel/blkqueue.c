@@ -0,0 +1,356 @@
+/**
+ * OpenWare OS - Block Request Queue
+ * Copyright (c) 2026 Ventryx Inc. All rights reserved.
+ */
+
+#include "blkqueue.h"
+#include "memory.h"
+#include "cpu.h"
+
+/* Queues holding deferred work */
+static blk_queue_t* deferred_head = NULL;
+
+static uint32_t log2_bucket(uint32_t value) {
+    uint32_t bucket = 0;
+    while (value > 1 && bucket < BLKQ_HIST_BUCKETS - 1) {
+        value >>= 1;
+        bucket++;
+    }
+    return bucket;
+}
+
+/**
+ * Create the request queue for a device (called by blockdev_register)
+ */
+blk_queue_t* blkq_create(blockdev_t* dev) {
+    blk_queue_t* q = (blk_queue_t*)kcalloc(1, sizeof(blk_queue_t));
+    if (!q) return NULL;
+    q->dev = dev;
+    dev->queue = q;
+    return q;
+}
+
+static bool ranges_overlap(uint32_t a, uint32_t a_count, uint32_t b, uint32_t b_count) {
+    return a < b + b_count && b < a + a_count;
+}
+
+/* Append every member of 'src' group to the tail of 'dst' group */
+static void group_append(blk_request_t* dst, blk_request_t* src) {
+    blk_request_t* tail = dst;
+    while (tail->merge_next) tail = tail->merge_next;
+    tail->merge_next = src;
+    dst->group_count += src->group_count;
+}
+
+/* Keep the queue sorted by LBA so the elevator can sweep it */
+static void insert_sorted(blk_queue_t* q, blk_request_t* req) {
+    blk_request_t** link = &q->head;
+    while (*link && (*link)->lba <= req->lba) link = &(*link)->next;
+    req->next = *link;
+    *link = req;
+}
+
+static void unlink_group(blk_queue_t* q, blk_request_t* group) {
+    blk_request_t** link = &q->head;
+    while (*link && *link != group) link = &(*link)->next;
+    if (*link) *link = group->next;
+    group->next = NULL;
+}
+
+/* Try to fold a request into an adjacent queued group of the same kind */
+static bool try_merge(blk_queue_t* q, blk_request_t* req) {
+    blk_request_t* prev = NULL;
+
+    for (blk_request_t* g = q->head; g; prev = g, g = g->next) {
+        if (g->op != req->op) continue;
+
+        /* Back merge: req starts where the group ends */
+        if (req->lba == g->lba + g->group_count &&
+            g->group_count + req->count <= BLKQ_MAX_MERGE_SECTORS) {
+            group_append(g, req);
+
+            /* The grown group may now touch the next one */
+            blk_request_t* n = g->next;
+            if (n && n->op == g->op && n->lba == g->lba + g->group_count &&
+                g->group_count + n->group_count <= BLKQ_MAX_MERGE_SECTORS) {
+                g->next = n->next;
+                group_append(g, n);
+            }
+            return true;
+        }
+
+        /* Front merge: req ends where the group starts, req becomes leader.
+         * The group now starts lower, so it is put back in LBA order. */
+        if (req->lba + req->count == g->lba &&
+            g->group_count + req->count <= BLKQ_MAX_MERGE_SECTORS) {
+            if (prev) prev->next = g->next;
+            else q->head = g->next;
+            g->next = NULL;
+            req->merge_next = g;
+            req->group_count = req->count + g->group_count;
+            insert_sorted(q, req);
+
+            /* The grown group may now continue one that ends where it starts */
+            for (blk_request_t* p = q->head; p; p = p->next) {
+                if (p != req && p->op == req->op && p->lba + p->group_count == req->lba &&
+                    p->group_count + req->group_count <= BLKQ_MAX_MERGE_SECTORS) {
+                    unlink_group(q, req);
+                    group_append(p, req);
+                    break;
+                }
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+static void complete_request(blk_queue_t* q, blk_request_t* req, int status) {
+    uint64_t cycles = cpu_rdtsc() - req->submit_tsc;
+    uint32_t kcycles = (cycles >> 10) > 0xFFFFFFFF ? 0xFFFFFFFF : (uint32_t)(cycles >> 10);
+    q->stats.latency_hist[log2_bucket(kcycles)]++;
+    q->stats.depth--;
+
+    req->status = status;
+    if (req->complete) req->complete(req);
+}
+
+/* Issue one merge group to the driver */
+static void dispatch_group(blk_queue_t* q, blk_request_t* group) {
+    blockdev_t* dev = q->dev;
+    int status;
+
+    q->stats.depth_hist[log2_bucket(q->stats.depth)]++;
+
+    if (!group->merge_next) {
+        status = blockdev_do_io(dev, group->op, group->lba, group->count, group->buffer);
+        q->stats.dispatched++;
+        q->head_pos = group->lba + group->count;
+        complete_request(q, group, status == 0 ? BLKQ_DONE : BLKQ_ERROR);
+        return;
+    }
+
+    /* Completions may free requests, including the leader: copy what we need */
+    uint32_t base = group->lba;
+    uint32_t total = group->group_count;
+    uint32_t op = group->op;
+    uint8_t* bounce = (uint8_t*)kmalloc(total * dev->sector_size);
+
+    if (!bounce) {
+        /* No memory for a bounce buffer: issue members one by one */
+        blk_request_t* req = group;
+        while (req) {
+            blk_request_t* next = req->merge_next;
+            status = blockdev_do_io(dev, req->op, req->lba, req->count, req->buffer);
+            q->stats.dispatched++;
+            complete_request(q, req, status == 0 ? BLKQ_DONE : BLKQ_ERROR);
+            req = next;
+        }
+        q->head_pos = base + total;
+        return;
+    }
+
+    if (op == BLKQ_WRITE) {
+        for (blk_request_t* req = group; req; req = req->merge_next) {
+            kmemcpy(bounce + (req->lba - base) * dev->sector_size, req->buffer,
+                    req->count * dev->sector_size);
+        }
+    }
+
+    status = blockdev_do_io(dev, op, base, total, bounce);
+    q->stats.dispatched++;
+    q->head_pos = base + total;
+
+    blk_request_t* req = group;
+    while (req) {
+        blk_request_t* next = req->merge_next;
+        if (status == 0 && req->op == BLKQ_READ) {
+            kmemcpy(req->buffer, bounce + (req->lba - base) * dev->sector_size,
+                    req->count * dev->sector_size);
+        }
+        complete_request(q, req, status == 0 ? BLKQ_DONE : BLKQ_ERROR);
+        req = next;
+    }
+
+    kfree(bounce);
+}
+
+/**
+ * Dispatch, in queue order, every group an access to [lba, lba + count)
+ * must not overtake: any that overlaps it when either side is a write.
+ * Afterwards nothing queued conflicts with the access, so the elevator
+ * is free to reorder what remains. Safe mid-dispatch (from completions).
+ */
+static void dispatch_conflicts(blk_queue_t* q, uint32_t op, uint32_t lba, uint32_t count) {
+    bool was_running = q->running;
+    q->running = true;      /* Completions must not start a full run */
+
+    blk_request_t* g = q->head;
+    while (g) {
+        if ((op == BLKQ_WRITE || g->op == BLKQ_WRITE) &&
+            ranges_overlap(lba, count, g->lba, g->group_count)) {
+            unlink_group(q, g);
+            dispatch_group(q, g);
+            g = q->head;    /* Completions may have changed the queue */
+            continue;
+        }
+        g = g->next;
+    }
+
+    q->running = was_running;
+}
+
+/**
+ * Dispatch everything queued, in C-LOOK order
+ */
+void blkq_run(blockdev_t* dev) {
+    blk_queue_t* q = dev->queue;
+    if (!q || q->running) return;   /* Completions may submit more work */
+    q->running = true;
+
+    while (q->head) {
+        /* First group at or past the head position, else wrap to the lowest */
+        blk_request_t* prev = NULL;
+        blk_request_t* group = q->head;
+        while (group && group->lba < q->head_pos) {
+            prev = group;
+            group = group->next;
+        }
+        if (!group) {
+            prev = NULL;
+            group = q->head;
+        }
+
+        if (prev) prev->next = group->next;
+        else q->head = group->next;
+        group->next = NULL;
+
+        dispatch_group(q, group);
+    }
+
+    q->running = false;
+}
+
+/**
+ * Queue a request. Completion is reported through req->status and
+ * req->complete once the queue is run.
+ */
+void blkq_submit(blockdev_t* dev, blk_request_t* req) {
+    blk_queue_t* q = dev->queue;
+
+    req->next = NULL;
+    req->merge_next = NULL;
+    req->group_count = req->count;
+    req->submit_tsc = cpu_rdtsc();
+    req->status = BLKQ_PENDING;
+
+    if (req->count == 0 || req->lba >= dev->sector_count ||
+        req->count > dev->sector_count - req->lba) {
+        dev->errors++;
+        req->status = BLKQ_ERROR;
+        if (req->complete) req->complete(req);
+        return;
+    }
+
+    if (!q) {
+        int status = blockdev_do_io(dev, req->op, req->lba, req->count, req->buffer);
+        req->status = status == 0 ? BLKQ_DONE : BLKQ_ERROR;
+        if (req->complete) req->complete(req);
+        return;
+    }
+
+    /* A write touching anything queued (or a read touching a queued write)
+     * must not be reordered around it: issue those first. This also works
+     * when called from a completion, where blkq_run would return at once. */
+    dispatch_conflicts(q, req->op, req->lba, req->count);
+
+    q->stats.submitted++;
+    q->stats.depth++;
+
+    if (try_merge(q, req)) {
+        q->stats.merged++;
+    } else {
+        insert_sorted(q, req);
+    }
+
+    if (!q->plugged || q->stats.depth >= BLKQ_MAX_DEPTH) blkq_run(dev);
+}
+
+/**
+ * Hold dispatch so a batch of submissions can be merged and sorted
+ */
+void blkq_plug(blockdev_t* dev) {
+    if (dev->queue) dev->queue->plugged++;
+}
+
+void blkq_unplug(blockdev_t* dev) {
+    blk_queue_t* q = dev->queue;
+    if (!q || q->plugged == 0) return;
+    if (--q->plugged == 0) blkq_run(dev);
+}
+
+/**
+ * Unplug without dispatching: the batch waits for the device's next
+ * dispatch or for blkq_poll, so the caller doesn't wait for the I/O
+ */
+void blkq_unplug_deferred(blockdev_t* dev) {
+    blk_queue_t* q = dev->queue;
+    if (!q || q->plugged == 0) return;
+    q->plugged--;
+
+    if (q->head && !q->deferred) {
+        q->deferred = true;
+        q->deferred_next = deferred_head;
+        deferred_head = q;
+    }
+}
+
+/**
+ * Dispatch the deferred batches of every device. Returns how many queues
+ * were run.
+ */
+uint32_t blkq_poll(void) {
+    uint32_t ran = 0;
+    while (deferred_head) {
+        blk_queue_t* q = deferred_head;
+        deferred_head = q->deferred_next;
+        q->deferred = false;
+
+        if (q->plugged == 0) {
+            blkq_run(q->dev);
+            ran++;
+        }
+    }
+    return ran;
+}
+
+/**
+ * Submit and wait. Waiting on a plugged queue dispatches the batch early.
+ */
+int blkq_rw_sync(blockdev_t* dev, uint32_t op, uint32_t lba, uint32_t count, uint8_t* buffer) {
+    /* Called from a completion callback: the queue is mid-dispatch. Go
+     * straight to the driver, after anything queued it must not overtake. */
+    if (dev->queue && dev->queue->running) {
+        dispatch_conflicts(dev->queue, op, lba, count);
+        return blockdev_do_io(dev, op, lba, count, buffer);
+    }
+
+    blk_request_t req;
+    req.op = op;
+    req.lba = lba;
+    req.count = count;
+    req.buffer = buffer;
+    req.complete = NULL;
+    req.ctx = NULL;
+
+    blkq_submit(dev, &req);
+    if (req.status == BLKQ_PENDING) blkq_run(dev);
+
+    return req.status == BLKQ_DONE ? 0 : -1;
+}
+
+bool blkq_get_stats(blockdev_t* dev, blkq_stats_t* stats) {
+    if (!dev || !dev->queue) return false;
+    kmemcpy(stats, &dev->queue->stats, sizeof(blkq_stats_t));
+    return true;
+}
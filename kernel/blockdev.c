@@ -0,0 +1,125 @@
+/**
+ * OpenWare OS - Generic Block Device Layer
+ * Copyright (c) 2026 Ventryx Inc. All rights reserved.
+ */
+
+#include "blockdev.h"
+#include "blkqueue.h"
+
+static blockdev_t* devices[BLOCKDEV_MAX];
+static uint32_t device_count = 0;
+
+static int name_equals(const char* a, const char* b) {
+    while (*a && *a == *b) {
+        a++;
+        b++;
+    }
+    return *a == *b;
+}
+
+/**
+ * Add a device to the registry. Names must be unique.
+ */
+int blockdev_register(blockdev_t* dev) {
+    if (!dev || device_count >= BLOCKDEV_MAX) return -1;
+    if (blockdev_find(dev->name)) return -1;
+
+    if (dev->sector_size == 0) dev->sector_size = 512;
+    dev->read_ops = 0;
+    dev->write_ops = 0;
+    dev->sectors_read = 0;
+    dev->sectors_written = 0;
+    dev->errors = 0;
+
+    devices[device_count++] = dev;
+    blkq_create(dev);
+    return 0;
+}
+
+/**
+ * Look up a device by name (e.g. "ram0", "hda")
+ */
+blockdev_t* blockdev_find(const char* name) {
+    for (uint32_t i = 0; i < device_count; i++) {
+        if (name_equals(devices[i]->name, name)) return devices[i];
+    }
+    return NULL;
+}
+
+blockdev_t* blockdev_get(uint32_t index) {
+    if (index >= device_count) return NULL;
+    return devices[index];
+}
+
+uint32_t blockdev_count(void) {
+    return device_count;
+}
+
+/**
+ * Issue a transfer straight to the driver and account for it
+ */
+int blockdev_do_io(blockdev_t* dev, uint32_t op, uint32_t lba, uint32_t count, uint8_t* buffer) {
+    int result;
+
+    if (op == BLKQ_WRITE) {
+        if (!dev->write) return -1;
+        dev->write_ops++;
+        dev->sectors_written += count;
+        result = dev->write(dev, lba, count, buffer);
+    } else {
+        if (!dev->read) return -1;
+        dev->read_ops++;
+        dev->sectors_read += count;
+        result = dev->read(dev, lba, count, buffer);
+    }
+
+    if (result != 0) {
+        dev->errors++;
+        return -1;
+    }
+    return 0;
+}
+
+static int blockdev_rw(blockdev_t* dev, uint32_t op, uint32_t lba, uint32_t count, uint8_t* buffer) {
+    if (!dev) return -1;
+    if (lba >= dev->sector_count || count > dev->sector_count - lba) {
+        dev->errors++;
+        return -1;
+    }
+
+    if (dev->queue) return blkq_rw_sync(dev, op, lba, count, buffer);
+    return blockdev_do_io(dev, op, lba, count, buffer);
+}
+
+/**
+ * Read sectors, bounds-checked against the device capacity
+ */
+int blockdev_read(blockdev_t* dev, uint32_t lba, uint32_t count, uint8_t* buffer) {
+    return blockdev_rw(dev, BLKQ_READ, lba, count, buffer);
+}
+
+/**
+ * Write sectors, bounds-checked against the device capacity
+ */
+int blockdev_write(blockdev_t* dev, uint32_t lba, uint32_t count, const uint8_t* buffer) {
+    return blockdev_rw(dev, BLKQ_WRITE, lba, count, (uint8_t*)buffer);
+}
+
+/**
+ * Flush any volatile write cache on the device
+ */
+int blockdev_flush(blockdev_t* dev) {
+    if (!dev) return -1;
+    if (!dev->flush) return 0;
+    return dev->flush(dev);
+}
+
+/**
+ * Map sectors of a memory-backed device for zero-copy access.
+ * Returns NULL if the device has no direct access or the range is invalid.
+ */
+uint8_t* blockdev_direct_access(blockdev_t* dev, uint32_t lba, uint32_t count) {
+    if (!dev || !dev->direct_access) return NULL;
+    if (lba >= dev->sector_count || count > dev->sector_count - lba) return NULL;
+    return dev->direct_access(dev, lba, count);
+}
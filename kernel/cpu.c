@@ -0,0 +1,60 @@
+/**
+ * OpenWare OS - CPU Feature Detection
+ * Copyright (c) 2026 Ventryx Inc. All rights reserved.
+ */
+
+#include "cpu.h"
+
+static bool sse2 = false;
+
+static inline void cpuid(uint32_t leaf, uint32_t* a, uint32_t* b, uint32_t* c, uint32_t* d) {
+    __asm__ volatile("cpuid" : "=a"(*a), "=b"(*b), "=c"(*c), "=d"(*d) : "a"(leaf));
+}
+
+/* CPUID exists if the ID flag (bit 21) of EFLAGS can be toggled */
+static bool has_cpuid(void) {
+    uint32_t before, after;
+    __asm__ volatile(
+        "pushfl\n\t"
+        "pushfl\n\t"
+        "popl %0\n\t"
+        "movl %0, %1\n\t"
+        "xorl $0x200000, %1\n\t"
+        "pushl %1\n\t"
+        "popfl\n\t"
+        "pushfl\n\t"
+        "popl %1\n\t"
+        "popfl"
+        : "=&r"(before), "=&r"(after));
+    return ((before ^ after) & 0x200000) != 0;
+}
+
+void cpu_init(void) {
+    uint32_t a, b, c, d;
+    
+    sse2 = false;
+    if (!has_cpuid()) return;
+    
+    cpuid(0, &a, &b, &c, &d);
+    if (a < 1) return;
+    
+    cpuid(1, &a, &b, &c, &d);
+    uint32_t needed = CPUID_EDX_FXSR | CPUID_EDX_SSE | CPUID_EDX_SSE2;
+    if ((d & needed) != needed) return;
+    
+    // No FPU emulation, and let the OS own the SSE state
+    uint32_t cr0, cr4;
+    __asm__ volatile("movl %%cr0, %0" : "=r"(cr0));
+    cr0 = (cr0 & ~CR0_EM) | CR0_MP;
+    __asm__ volatile("movl %0, %%cr0" : : "r"(cr0));
+    
+    __asm__ volatile("movl %%cr4, %0" : "=r"(cr4));
+    cr4 |= CR4_OSFXSR | CR4_OSXMMEXCPT;
+    __asm__ volatile("movl %0, %%cr4" : : "r"(cr4));
+    
+    sse2 = true;
+}
+
+bool cpu_has_sse2(void) {
+    return sse2;
+}
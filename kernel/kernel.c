@@ -12,12 +12,35 @@
 #include "shell.h"
 #include "memory.h"
 #include "ata.h"
+#include "ramdisk.h"
+#include "blockdev.h"
+#include "bcache.h"
+#include "../fs/fat32.h"
+#include "../fs/pagecache.h"
+#include "../fs/tmpfs.h"
 #include "version.h"
 #include "vbe.h"
+#include "cpu.h"
 #include "mouse.h"
 #include "ui.h"
+#include "timer.h"
 
 
+/**
+ * Mount a tmpfs for scratch files on /tmp, or as the root if no disk
+ * filesystem came up
+ */
+static int mount_scratch(void) {
+    if (!fs_root) return tmpfs_mount("/", TMPFS_DEFAULT_MAX);
+    
+    fs_node_t* tmp = vfs_lookup_path("/tmp");
+    if (!tmp) tmp = vfs_create(fs_root, "tmp", FS_DIRECTORY);
+    if (!tmp) return -1;
+    vfs_close(tmp);
+    
+    return tmpfs_mount("/tmp", TMPFS_DEFAULT_MAX);
+}
+
 /**
  * Print system initialization status (Graphics Version)
  */
@@ -37,6 +60,9 @@ static void print_status_graphics(const char* component, bool success) {
  * Kernel main entry point
  */
 void kmain(void) {
+    /* Detect CPU features first, the 2D layer picks its fast paths from them */
+    cpu_init();
+    
     /* Initialize VBE Graphics */
     vbe_init();
     vbe_enable_double_buffering();
@@ -54,6 +80,8 @@ void kmain(void) {
     
     vbe_print("Initializing system components in Graphics Mode...\n\n", COLOR_WHITE);
     
+    print_status_graphics(cpu_has_sse2() ? "CPU Features (SSE2 fast paths)" : "CPU Features (no SSE2)", true);
+    
     /* Initialize GDT */
     gdt_init();
     print_status_graphics("Global Descriptor Table (GDT)", true);
@@ -62,6 +90,10 @@ void kmain(void) {
     idt_init();
     print_status_graphics("Interrupt Descriptor Table (IDT)", true);
     
+    /* Initialize the system tick */
+    timer_init(TIMER_HZ);
+    print_status_graphics("PIT Timer (1000 Hz)", true);
+    
     /* Initialize keyboard */
     keyboard_init();
     print_status_graphics("PS/2 Keyboard Driver", true);
@@ -74,9 +106,19 @@ void kmain(void) {
     memory_init();
     print_status_graphics("Memory Manager (Heap)", true);
 
+    /* Initialize block buffer cache */
+    print_status_graphics("Block Buffer Cache", bcache_init(BCACHE_DEFAULT_BUFFERS) == 0);
+    print_status_graphics("File Page Cache", pagecache_init(PAGECACHE_DEFAULT_PAGES) == 0);
+
     /* Initialize ATA */
     ata_init();
     print_status_graphics("ATA PIO Driver", true);
+
+    /* Register the embedded ramdisk and mount it as root */
+    ramdisk_init();
+    print_status_graphics("Ramdisk Block Device (ram0)", blockdev_find("ram0") != NULL);
+    print_status_graphics("FAT32 Root Filesystem", fat32_init(blockdev_find("ram0")) == 0);
+    print_status_graphics("tmpfs Scratch Filesystem", mount_scratch() == 0);
     
     /* Initialize UI */
     ui_init();
@@ -87,8 +129,11 @@ void kmain(void) {
     vbe_print("\nOpenWare kernel initialized successfully!\n", COLOR_GREEN);
     vbe_print("Launching GUI System...\n", COLOR_WHITE);
     
-    // For now, render once to show the windows
+    // Show the windows, then leave presenting to the frame clock
     ui_render();
+    vbe_present();
+    timer_set_hook(vbe_frame_tick);
+    vbe_set_refresh(VBE_REFRESH_HZ);
 
     
     /* Initialize and run the shell */
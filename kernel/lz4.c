@@ -0,0 +1,68 @@
+/**
+ * OpenWare OS - LZ4 Block Decompressor
+ * Copyright (c) 2026 Ventryx Inc. All rights reserved.
+ *
+ * Sequence layout: token (literal length:4 | match length-4:4),
+ * [extra literal length bytes], literals, 16-bit LE offset,
+ * [extra match length bytes]. The last sequence has literals only.
+ */
+
+#include "lz4.h"
+
+/* Length fields of 15 continue in following bytes until one is < 255 */
+static bool read_length(const uint8_t** ip, const uint8_t* iend, uint32_t* len) {
+    uint8_t b;
+    do {
+        if (*ip >= iend) return false;
+        b = *(*ip)++;
+        *len += b;
+    } while (b == 255);
+    return true;
+}
+
+int lz4_decompress(const uint8_t* src, uint32_t src_len, uint8_t* dst, uint32_t dst_len) {
+    const uint8_t* ip = src;
+    const uint8_t* iend = src + src_len;
+    uint8_t* op = dst;
+    uint8_t* oend = dst + dst_len;
+
+    while (ip < iend) {
+        uint8_t token = *ip++;
+
+        /* Literals */
+        uint32_t lit = token >> 4;
+        if (lit == 15 && !read_length(&ip, iend, &lit)) return -1;
+        if (lit > (uint32_t)(iend - ip) || lit > (uint32_t)(oend - op)) return -1;
+        for (uint32_t i = 0; i < lit; i++) op[i] = ip[i];
+        ip += lit;
+        op += lit;
+
+        /* Last sequence ends after its literals */
+        if (ip >= iend) break;
+
+        /* Match */
+        if (iend - ip < 2) return -1;
+        uint32_t offset = ip[0] | ((uint32_t)ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (uint32_t)(op - dst)) return -1;
+
+        uint32_t len = (token & 15) + 4;
+        if ((token & 15) == 15 && !read_length(&ip, iend, &len)) return -1;
+        if (len > (uint32_t)(oend - op)) return -1;
+
+        const uint8_t* match = op - offset;
+        if (offset >= 4) {
+            /* Non-overlapping 4-byte steps, then the tail */
+            while (len >= 4) {
+                *(uint32_t*)op = *(const uint32_t*)match;
+                op += 4;
+                match += 4;
+                len -= 4;
+            }
+        }
+        /* Overlapping matches (RLE-style) must go byte by byte */
+        while (len-- > 0) *op++ = *match++;
+    }
+
+    return (int)(op - dst);
+}
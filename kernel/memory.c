@@ -7,19 +7,34 @@
 
 static alloc_block_t* heap_start = (alloc_block_t*)HEAP_START;
 
+static mem_shrinker_t shrinkers[MEMORY_MAX_SHRINKERS];
+static uint32_t shrinker_count = 0;
+
 void memory_init(void) {
     heap_start->size = HEAP_SIZE - sizeof(alloc_block_t);
     heap_start->free = true;
     heap_start->next = NULL;
 }
 
-void* kmalloc(size_t size) {
-    // Align size to 4 bytes
-    size = (size + 3) & ~3;
-    
+/**
+ * Register a cache that can give memory back when the heap runs out
+ */
+int memory_register_shrinker(mem_shrinker_t shrinker) {
+    if (shrinker_count >= MEMORY_MAX_SHRINKERS) return -1;
+    shrinkers[shrinker_count++] = shrinker;
+    return 0;
+}
+
+static void* heap_alloc(size_t size) {
     alloc_block_t* current = heap_start;
     
     while (current != NULL) {
+        // Coalesce free neighbours that kfree() couldn't merge backwards
+        while (current->free && current->next && current->next->free) {
+            current->size += current->next->size + sizeof(alloc_block_t);
+            current->next = current->next->next;
+        }
+        
         if (current->free && current->size >= size) {
             // Can we split this block?
             if (current->size >= size + sizeof(alloc_block_t) + 4) {
@@ -42,6 +57,29 @@ void* kmalloc(size_t size) {
     return NULL; // Out of memory
 }
 
+void* kmalloc(size_t size) {
+    // Align size to 4 bytes
+    size = (size + 3) & ~3;
+    
+    void* ptr = heap_alloc(size);
+    if (ptr) return ptr;
+    
+    // Out of memory: ask the caches to shrink and retry while they make progress
+    static bool shrinking = false;
+    if (shrinking) return NULL;
+    shrinking = true;
+    
+    for (uint32_t i = 0; i < shrinker_count && !ptr; i++) {
+        while (shrinkers[i](size) > 0) {
+            ptr = heap_alloc(size);
+            if (ptr) break;
+        }
+    }
+    
+    shrinking = false;
+    return ptr;
+}
+
 void kfree(void* ptr) {
     if (ptr == NULL) return;
     
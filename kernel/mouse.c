@@ -1,5 +1,6 @@
 #include "mouse.h"
 #include "vbe.h"
+#include "ui.h"
 
 #define MOUSE_DATA_PORT 0x60
 #define MOUSE_STATUS_PORT 0x64
@@ -70,16 +71,12 @@ void mouse_handler(registers_t* regs) {
         // Clamp to screen
         if (mouse_x < 0) mouse_x = 0;
         if (mouse_y < 0) mouse_y = 0;
-        if (mouse_x > 1024) mouse_x = 1024; // Needs dynamic check
-        if (mouse_y > 768) mouse_y = 768;
-
-        // Draw cursor (simple cross for now)
-        // Note: Real cursor needs sprite and double buffering swap
-        vbe_putpixel(mouse_x, mouse_y, COLOR_WHITE);
-        vbe_putpixel(mouse_x+1, mouse_y, COLOR_WHITE);
-        vbe_putpixel(mouse_x-1, mouse_y, COLOR_WHITE);
-        vbe_putpixel(mouse_x, mouse_y+1, COLOR_WHITE);
-        vbe_putpixel(mouse_x, mouse_y-1, COLOR_WHITE);
+        if (mouse_x >= vbe_get_width()) mouse_x = vbe_get_width() - 1;
+        if (mouse_y >= vbe_get_height()) mouse_y = vbe_get_height() - 1;
+
+        // The compositor draws the cursor later, outside the interrupt;
+        // bit 0 of the first byte is the left button
+        ui_handle_mouse(mouse_x, mouse_y, mouse_packet[0] & 0x01);
     }
 }
 
@@ -0,0 +1,177 @@
+/**
+ * OpenWare OS - Framebuffer Pixel Formats
+ * Copyright (c) 2026 Ventryx Inc. All rights reserved.
+ */
+
+#include "pixfmt.h"
+#include "span.h"
+
+/* Field sizes and positions for the generic formats (red, green, blue) */
+static uint8_t field_size[3];
+static uint8_t field_pos[3];
+
+static inline uint32_t scale_field(uint32_t value, uint8_t size) {
+    return size <= 8 ? value >> (8 - size) : value << (size - 8);
+}
+
+static uint32_t encode_generic(uint32_t color) {
+    return (scale_field((color >> 16) & 0xFF, field_size[0]) << field_pos[0]) |
+           (scale_field((color >> 8) & 0xFF, field_size[1]) << field_pos[1]) |
+           (scale_field(color & 0xFF, field_size[2]) << field_pos[2]);
+}
+
+/* Field 'value' of 'size' bits widened to 8 bits */
+static inline uint32_t widen_field(uint32_t value, uint8_t size) {
+    if (size >= 8) return value >> (size - 8);
+    uint32_t max = (1u << size) - 1;
+    return max ? (value * 255 + max / 2) / max : 0;
+}
+
+static uint32_t decode_generic(uint32_t pixel) {
+    uint32_t color = 0;
+    for (int i = 0; i < 3; i++) {
+        uint32_t value = (pixel >> field_pos[i]) & ((1u << field_size[i]) - 1);
+        color = (color << 8) | widen_field(value, field_size[i]);
+    }
+    return color;
+}
+
+#define ENCODE_XRGB8888(c)  (c)
+#define ENCODE_RGB888(c)    ((c) & 0x00FFFFFF)
+#define ENCODE_RGB565(c)    ((((c) >> 8) & 0xF800) | (((c) >> 5) & 0x07E0) | (((c) >> 3) & 0x001F))
+#define ENCODE_RGB555(c)    ((((c) >> 9) & 0x7C00) | (((c) >> 6) & 0x03E0) | (((c) >> 3) & 0x001F))
+#define ENCODE_GENERIC(c)   encode_generic(c)
+
+/* Back to 0x00RRGGBB; narrow fields repeat their top bits to fill 8 */
+#define DECODE_RGB888(p)    ((p) & 0x00FFFFFF)
+#define DECODE_RGB565(p)    ((((p) << 8) & 0xF80000) | (((p) << 3) & 0x070000) |   \
+                             (((p) << 5) & 0x00FC00) | (((p) >> 1) & 0x000300) |   \
+                             (((p) << 3) & 0x0000F8) | (((p) >> 2) & 0x000007))
+#define DECODE_RGB555(p)    ((((p) << 9) & 0xF80000) | (((p) << 4) & 0x070000) |   \
+                             (((p) << 6) & 0x00F800) | (((p) << 1) & 0x000700) |   \
+                             (((p) << 3) & 0x0000F8) | (((p) >> 2) & 0x000007))
+#define DECODE_GENERIC(p)   decode_generic(p)
+
+#define STORE16(p, v)   (*(uint16_t*)(p) = (uint16_t)(v))
+#define STORE24(p, v)   ((p)[0] = (uint8_t)(v), (p)[1] = (uint8_t)((v) >> 8), (p)[2] = (uint8_t)((v) >> 16))
+#define STORE32(p, v)   (*(uint32_t*)(p) = (v))
+
+#define LOAD16(p)       (*(const uint16_t*)(p))
+#define LOAD24(p)       ((p)[0] | ((p)[1] << 8) | ((uint32_t)(p)[2] << 16))
+#define LOAD32(p)       (*(const uint32_t*)(p))
+
+static void fill16(uint8_t* dst, uint32_t pixel, uint32_t n) {
+    uint16_t* p = (uint16_t*)dst;
+    
+    // Pairs of pixels as 32-bit words once aligned
+    if (((uint32_t)p & 2) && n) {
+        *p++ = pixel;
+        n--;
+    }
+    span_fill32((uint32_t*)p, (pixel & 0xFFFF) * 0x10001, n / 2);
+    if (n & 1) p[n - 1] = pixel;
+}
+
+static void fill24(uint8_t* dst, uint32_t pixel, uint32_t n) {
+    // Four pixels are three words: BGRB GRBG RBGR
+    uint32_t w0 = (pixel & 0xFFFFFF) | (pixel << 24);
+    uint32_t w1 = ((pixel >> 8) & 0xFFFF) | (pixel << 16);
+    uint32_t w2 = ((pixel >> 16) & 0xFF) | (pixel << 8);
+    
+    for (; n >= 4; n -= 4, dst += 12) {
+        ((uint32_t*)dst)[0] = w0;
+        ((uint32_t*)dst)[1] = w1;
+        ((uint32_t*)dst)[2] = w2;
+    }
+    for (; n; n--, dst += 3) STORE24(dst, pixel);
+}
+
+static void fill32(uint8_t* dst, uint32_t pixel, uint32_t n) {
+    span_fill32((uint32_t*)dst, pixel, n);
+}
+
+static void copy32(uint8_t* dst, const uint32_t* src, uint32_t n) {
+    span_copy32((uint32_t*)dst, src, n);
+}
+
+/*
+ * Kernels for one format: BYTES per pixel, ENCODE turns 0x00RRGGBB into a
+ * pixel and STORE writes one, DECODE and LOAD do the reverse. FILL is the
+ * row fill for the pixel size and BLIT the row copy from 0x00RRGGBB,
+ * usually name##_convert. DIRECT formats store 0x00RRGGBB as it is.
+ */
+#define DEFINE_PIXFMT(name, BYTES, ENCODE, STORE, DECODE, LOAD, FILL, BLIT, DIRECT) \
+    static uint32_t name##_encode(uint32_t color) {                             \
+        return ENCODE(color);                                                   \
+    }                                                                           \
+    static void name##_put(uint8_t* dst, uint32_t pixel) {                      \
+        STORE(dst, pixel);                                                      \
+    }                                                                           \
+    __attribute__((unused))                                                     \
+    static void name##_convert(uint8_t* dst, const uint32_t* src, uint32_t n) { \
+        for (; n; n--, dst += BYTES, src++) {                                   \
+            uint32_t pixel = ENCODE(*src);                                      \
+            STORE(dst, pixel);                                                  \
+        }                                                                       \
+    }                                                                           \
+    static void name##_read(uint32_t* dst, const uint8_t* src, uint32_t n) {    \
+        for (; n; n--, dst++, src += BYTES) {                                   \
+            uint32_t pixel = LOAD(src);                                         \
+            *dst = DECODE(pixel);                                               \
+        }                                                                       \
+    }                                                                           \
+    static void name##_glyph(uint8_t* dst, uint8_t bits, int c0, int c1,        \
+                             uint32_t pixel) {                                  \
+        for (int j = c0; j < c1; j++) {                                         \
+            if (bits & (0x80 >> j)) STORE(dst + j * BYTES, pixel);              \
+        }                                                                       \
+    }                                                                           \
+    static const pixfmt_t name = {                                              \
+        #name, BYTES, DIRECT, name##_encode, name##_put, FILL, BLIT,            \
+        name##_read, name##_glyph                                               \
+    };
+
+DEFINE_PIXFMT(xrgb8888,  4, ENCODE_XRGB8888, STORE32, DECODE_RGB888,  LOAD32, fill32, copy32,            true)
+DEFINE_PIXFMT(rgb888,    3, ENCODE_RGB888,   STORE24, DECODE_RGB888,  LOAD24, fill24, rgb888_convert,    false)
+DEFINE_PIXFMT(rgb565,    2, ENCODE_RGB565,   STORE16, DECODE_RGB565,  LOAD16, fill16, rgb565_convert,    false)
+DEFINE_PIXFMT(rgb555,    2, ENCODE_RGB555,   STORE16, DECODE_RGB555,  LOAD16, fill16, rgb555_convert,    false)
+DEFINE_PIXFMT(generic32, 4, ENCODE_GENERIC,  STORE32, DECODE_GENERIC, LOAD32, fill32, generic32_convert, false)
+DEFINE_PIXFMT(generic24, 3, ENCODE_GENERIC,  STORE24, DECODE_GENERIC, LOAD24, fill24, generic24_convert, false)
+DEFINE_PIXFMT(generic16, 2, ENCODE_GENERIC,  STORE16, DECODE_GENERIC, LOAD16, fill16, generic16_convert, false)
+
+static bool layout_is(const vbe_mode_info_t* mode, uint8_t rs, uint8_t rp,
+                      uint8_t gs, uint8_t gp, uint8_t bs, uint8_t bp) {
+    return mode->red_mask == rs && mode->red_position == rp &&
+           mode->green_mask == gs && mode->green_position == gp &&
+           mode->blue_mask == bs && mode->blue_position == bp;
+}
+
+const pixfmt_t* pixfmt_select(const vbe_mode_info_t* mode) {
+    // VBE 1.x BIOSes may leave the fields empty: assume the usual layout
+    bool standard = mode->red_mask == 0 && mode->green_mask == 0 && mode->blue_mask == 0;
+    
+    field_size[0] = mode->red_mask;
+    field_pos[0] = mode->red_position;
+    field_size[1] = mode->green_mask;
+    field_pos[1] = mode->green_position;
+    field_size[2] = mode->blue_mask;
+    field_pos[2] = mode->blue_position;
+    
+    switch (mode->bpp) {
+    case 32:
+        if (standard || layout_is(mode, 8, 16, 8, 8, 8, 0)) return &xrgb8888;
+        return &generic32;
+    case 24:
+        if (standard || layout_is(mode, 8, 16, 8, 8, 8, 0)) return &rgb888;
+        return &generic24;
+    case 16:
+        if (standard || layout_is(mode, 5, 11, 6, 5, 5, 0)) return &rgb565;
+        if (layout_is(mode, 5, 10, 5, 5, 5, 0)) return &rgb555;
+        return &generic16;
+    case 15:
+        if (standard || layout_is(mode, 5, 10, 5, 5, 5, 0)) return &rgb555;
+        return &generic16;
+    default:
+        return NULL;
+    }
+}
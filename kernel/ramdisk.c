@@ -5,13 +5,120 @@
 
 #include "ramdisk.h"
 #include "../include/memory.h"
+#include "../include/blockdev.h"
+#include "../include/lz4.h"
 #include "vga.h"
 
+static blockdev_t ramdisk_dev;
+
+/* Compressed image state (rdz == NULL: raw image) */
+typedef struct {
+    int32_t chunk;              /* -1: empty */
+    uint8_t* data;
+    uint32_t last_use;
+} chunk_slot_t;
+
+static rdz_header_t* rdz = NULL;
+static uint8_t** pinned = NULL; /* Written chunks stay resident for good */
+static chunk_slot_t chunk_cache[RAMDISK_CHUNK_CACHE];
+static uint32_t use_clock = 0;
+
 /* Helper to get ramdisk size */
 static uint32_t ramdisk_get_size(void) {
+    if (rdz) return rdz->image_size;
     return (uint32_t)_binary_ramdisk_img_end - (uint32_t)_binary_ramdisk_img_start;
 }
 
+/* Decompress chunk 'index' into 'dst' */
+static bool rdz_inflate(uint32_t index, uint8_t* dst) {
+    uint8_t* src = (uint8_t*)_binary_ramdisk_img_start + rdz->offsets[index];
+    uint32_t stored = rdz->offsets[index + 1] - rdz->offsets[index];
+    uint32_t len = rdz->image_size - index * rdz->chunk_size;
+    if (len > rdz->chunk_size) len = rdz->chunk_size;
+    
+    if (stored == 0) {
+        kmemset(dst, 0, len);
+        return true;
+    }
+    if (stored == len) {
+        kmemcpy(dst, src, len);
+        return true;
+    }
+    return lz4_decompress(src, stored, dst, len) == (int)len;
+}
+
+/* Get the decompressed contents of a chunk, decompressing on first access */
+static uint8_t* rdz_chunk(uint32_t index) {
+    if (pinned[index]) return pinned[index];
+    
+    chunk_slot_t* victim = &chunk_cache[0];
+    for (int i = 0; i < RAMDISK_CHUNK_CACHE; i++) {
+        if (chunk_cache[i].chunk == (int32_t)index) {
+            chunk_cache[i].last_use = ++use_clock;
+            return chunk_cache[i].data;
+        }
+        if (chunk_cache[i].last_use < victim->last_use) victim = &chunk_cache[i];
+    }
+    
+    if (!victim->data) {
+        victim->data = (uint8_t*)kmalloc(rdz->chunk_size);
+        if (!victim->data) return NULL;
+    }
+    
+    victim->chunk = -1;
+    if (!rdz_inflate(index, victim->data)) return NULL;
+    
+    victim->chunk = (int32_t)index;
+    victim->last_use = ++use_clock;
+    return victim->data;
+}
+
+/* Same, but the chunk is about to be modified: take it out of the cache
+ * so it is never evicted (it can't be recompressed in place) */
+static uint8_t* rdz_chunk_for_write(uint32_t index) {
+    uint8_t* data = rdz_chunk(index);
+    if (!data || pinned[index]) return data;
+    
+    for (int i = 0; i < RAMDISK_CHUNK_CACHE; i++) {
+        if (chunk_cache[i].chunk == (int32_t)index) {
+            pinned[index] = chunk_cache[i].data;
+            chunk_cache[i].data = NULL;
+            chunk_cache[i].chunk = -1;
+            chunk_cache[i].last_use = 0;
+            break;
+        }
+    }
+    return pinned[index];
+}
+
+/* Copy bytes between the (possibly compressed) image and a buffer */
+static int ramdisk_copy(uint32_t offset, uint32_t size, uint8_t* buffer, bool write) {
+    if (!rdz) {
+        uint8_t* image = (uint8_t*)_binary_ramdisk_img_start + offset;
+        if (write) kmemcpy(image, buffer, size);
+        else kmemcpy(buffer, image, size);
+        return 0;
+    }
+    
+    while (size > 0) {
+        uint32_t index = offset / rdz->chunk_size;
+        uint32_t in_chunk = offset % rdz->chunk_size;
+        uint32_t len = rdz->chunk_size - in_chunk;
+        if (len > size) len = size;
+        
+        uint8_t* chunk = write ? rdz_chunk_for_write(index) : rdz_chunk(index);
+        if (!chunk) return -1;
+        
+        if (write) kmemcpy(chunk + in_chunk, buffer, len);
+        else kmemcpy(buffer, chunk + in_chunk, len);
+        
+        offset += len;
+        buffer += len;
+        size -= len;
+    }
+    return 0;
+}
+
 void ramdisk_read(uint32_t lba, uint8_t sectors, uint8_t* buffer) {
     uint32_t offset = lba * 512;
     uint32_t size = sectors * 512;
@@ -23,7 +130,7 @@ void ramdisk_read(uint32_t lba, uint8_t sectors, uint8_t* buffer) {
         size = max_size - offset;
     }
     
-    kmemcpy(buffer, (uint8_t*)_binary_ramdisk_img_start + offset, size);
+    ramdisk_copy(offset, size, buffer, false);
 }
 
 void ramdisk_write(uint32_t lba, uint8_t sectors, uint8_t* buffer) {
@@ -37,5 +144,74 @@ void ramdisk_write(uint32_t lba, uint8_t sectors, uint8_t* buffer) {
     }
     
     /* Write to memory */
-    kmemcpy((uint8_t*)_binary_ramdisk_img_start + offset, buffer, size);
+    ramdisk_copy(offset, size, buffer, true);
+}
+
+/* Block device operations (range already validated by the block layer) */
+static int ramdisk_dev_read(blockdev_t* dev, uint32_t lba, uint32_t count, uint8_t* buffer) {
+    (void)dev;
+    return ramdisk_copy(lba * 512, count * 512, buffer, false);
+}
+
+static int ramdisk_dev_write(blockdev_t* dev, uint32_t lba, uint32_t count, const uint8_t* buffer) {
+    (void)dev;
+    return ramdisk_copy(lba * 512, count * 512, (uint8_t*)buffer, true);
+}
+
+static uint8_t* ramdisk_dev_direct_access(blockdev_t* dev, uint32_t lba, uint32_t count) {
+    (void)dev;
+    (void)count;
+    return (uint8_t*)_binary_ramdisk_img_start + lba * 512;
+}
+
+/* Compressed image? Check the header before trusting it: the chunk table
+ * must fit, and every chunk must start after it, end no earlier than it
+ * starts and lie inside the image, so rdz_inflate never reads outside */
+static bool rdz_header_valid(rdz_header_t* header, uint32_t raw_size) {
+    if (raw_size < sizeof(rdz_header_t) || header->magic != RDZ_MAGIC) return false;
+    if (header->chunk_size == 0 || header->chunk_count == 0) return false;
+    if (header->chunk_count != (header->image_size + header->chunk_size - 1) / header->chunk_size) return false;
+    if (header->chunk_count >= (raw_size - sizeof(rdz_header_t)) / 4) return false;
+    
+    uint32_t table_end = sizeof(rdz_header_t) + (header->chunk_count + 1) * 4;
+    if (header->offsets[0] < table_end) return false;
+    for (uint32_t i = 0; i < header->chunk_count; i++) {
+        if (header->offsets[i + 1] < header->offsets[i]) return false;
+    }
+    return header->offsets[header->chunk_count] <= raw_size;
+}
+
+/**
+ * Register the embedded image as block device "ram0"
+ */
+void ramdisk_init(void) {
+    uint32_t raw_size = (uint32_t)_binary_ramdisk_img_end - (uint32_t)_binary_ramdisk_img_start;
+    rdz_header_t* header = (rdz_header_t*)_binary_ramdisk_img_start;
+    
+    if (rdz_header_valid(header, raw_size)) {
+        pinned = (uint8_t**)kcalloc(header->chunk_count, sizeof(uint8_t*));
+        if (!pinned) {
+            vga_puts("[RAMDISK] Out of memory for chunk table\n");
+            return;
+        }
+        for (int i = 0; i < RAMDISK_CHUNK_CACHE; i++) {
+            chunk_cache[i].chunk = -1;
+            chunk_cache[i].data = NULL;
+            chunk_cache[i].last_use = 0;
+        }
+        rdz = header;
+    }
+    
+    kmemset(&ramdisk_dev, 0, sizeof(blockdev_t));
+    kmemcpy(ramdisk_dev.name, "ram0", 5);
+    ramdisk_dev.sector_size = 512;
+    ramdisk_dev.sector_count = ramdisk_get_size() / 512;
+    ramdisk_dev.read = ramdisk_dev_read;
+    ramdisk_dev.write = ramdisk_dev_write;
+    ramdisk_dev.flush = 0;
+    
+    /* Only a raw image can be addressed in place */
+    ramdisk_dev.direct_access = rdz ? 0 : ramdisk_dev_direct_access;
+    
+    blockdev_register(&ramdisk_dev);
 }
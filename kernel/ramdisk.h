@@ -13,6 +13,24 @@ extern char _binary_ramdisk_img_start[];
 extern char _binary_ramdisk_img_end[];
 extern char _binary_ramdisk_img_size[];
 
+/*
+ * Compressed image format produced by tools/mkrdz: a header, a table of
+ * chunk offsets, then independently LZ4-compressed chunks. A chunk whose
+ * stored size equals its uncompressed size is stored raw, an empty one
+ * is all zeros. An image without the magic is a plain raw disk image.
+ */
+#define RDZ_MAGIC               0x315A4452  /* "RDZ1" */
+#define RAMDISK_CHUNK_CACHE     4           /* Decompressed chunks kept around */
+
+typedef struct {
+    uint32_t magic;
+    uint32_t chunk_size;
+    uint32_t image_size;        /* Uncompressed bytes */
+    uint32_t chunk_count;
+    uint32_t offsets[];         /* chunk_count + 1 entries, from image start */
+} __attribute__((packed)) rdz_header_t;
+
+void ramdisk_init(void);
 void ramdisk_read(uint32_t lba, uint8_t sectors, uint8_t* buffer);
 void ramdisk_write(uint32_t lba, uint8_t sectors, uint8_t* buffer);
 
@@ -0,0 +1,110 @@
+/**
+ * OpenWare OS - Screen Regions
+ * Copyright (c) 2026 Ventryx Inc. All rights reserved.
+ */
+
+#include "region.h"
+
+static int rect_area(const vbe_rect_t* r) {
+    return r->w * r->h;
+}
+
+static vbe_rect_t rect_union(const vbe_rect_t* a, const vbe_rect_t* b) {
+    vbe_rect_t u;
+    int x1 = a->x + a->w > b->x + b->w ? a->x + a->w : b->x + b->w;
+    int y1 = a->y + a->h > b->y + b->h ? a->y + a->h : b->y + b->h;
+    u.x = a->x < b->x ? a->x : b->x;
+    u.y = a->y < b->y ? a->y : b->y;
+    u.w = x1 - u.x;
+    u.h = y1 - u.y;
+    return u;
+}
+
+static bool rect_contains(const vbe_rect_t* outer, const vbe_rect_t* inner) {
+    return inner->x >= outer->x && inner->y >= outer->y &&
+           inner->x + inner->w <= outer->x + outer->w &&
+           inner->y + inner->h <= outer->y + outer->h;
+}
+
+bool rect_intersect(const vbe_rect_t* a, const vbe_rect_t* b, vbe_rect_t* out) {
+    int x0 = a->x > b->x ? a->x : b->x;
+    int y0 = a->y > b->y ? a->y : b->y;
+    int x1 = a->x + a->w < b->x + b->w ? a->x + a->w : b->x + b->w;
+    int y1 = a->y + a->h < b->y + b->h ? a->y + a->h : b->y + b->h;
+    if (x0 >= x1 || y0 >= y1) return false;
+    
+    out->x = x0;
+    out->y = y0;
+    out->w = x1 - x0;
+    out->h = y1 - y0;
+    return true;
+}
+
+void region_add(region_t* region, const vbe_rect_t* rect) {
+    if (rect->w <= 0 || rect->h <= 0) return;
+    
+    for (int i = 0; i < region->count; i++) {
+        vbe_rect_t* r = &region->rects[i];
+        if (rect_contains(r, rect)) return;
+        
+        // Free merge: the union covers nothing that isn't already listed
+        vbe_rect_t u = rect_union(r, rect);
+        vbe_rect_t overlap;
+        int covered = rect_area(r) + rect_area(rect);
+        if (rect_intersect(r, rect, &overlap)) covered -= rect_area(&overlap);
+        if (rect_area(&u) <= covered) {
+            *r = u;
+            return;
+        }
+    }
+    
+    if (region->count < REGION_MAX) {
+        region->rects[region->count++] = *rect;
+        return;
+    }
+    
+    int best = 0;
+    int best_growth = 0x7FFFFFFF;
+    for (int i = 0; i < region->count; i++) {
+        vbe_rect_t u = rect_union(&region->rects[i], rect);
+        int growth = rect_area(&u) - rect_area(&region->rects[i]);
+        if (growth < best_growth) {
+            best_growth = growth;
+            best = i;
+        }
+    }
+    region->rects[best] = rect_union(&region->rects[best], rect);
+}
+
+bool region_subtract(region_t* region, const vbe_rect_t* rect) {
+    vbe_rect_t out[REGION_MAX];
+    int count = 0;
+    
+    for (int i = 0; i < region->count; i++) {
+        vbe_rect_t* r = &region->rects[i];
+        vbe_rect_t hole;
+        
+        if (!rect_intersect(r, rect, &hole)) {
+            if (count == REGION_MAX) return false;
+            out[count++] = *r;
+            continue;
+        }
+        
+        // Up to four pieces: full-width bands above and below, then left and right
+        vbe_rect_t pieces[4] = {
+            { r->x, r->y, r->w, hole.y - r->y },
+            { r->x, hole.y + hole.h, r->w, r->y + r->h - hole.y - hole.h },
+            { r->x, hole.y, hole.x - r->x, hole.h },
+            { hole.x + hole.w, hole.y, r->x + r->w - hole.x - hole.w, hole.h },
+        };
+        for (int p = 0; p < 4; p++) {
+            if (pieces[p].w <= 0 || pieces[p].h <= 0) continue;
+            if (count == REGION_MAX) return false;
+            out[count++] = pieces[p];
+        }
+    }
+    
+    for (int i = 0; i < count; i++) region->rects[i] = out[i];
+    region->count = count;
+    return true;
+}
@@ -11,6 +11,7 @@
 
 
 #include "memory.h"
+#include "ui.h"
 
 /* String utilities */
 static size_t strlen(const char* str) {
@@ -37,6 +38,28 @@ static int strncmp(const char* s1, const char* s2, size_t n) {
     return *(unsigned char*)s1 - *(unsigned char*)s2;
 }
 
+/* Print an unsigned decimal number */
+static void print_dec(uint32_t value) {
+    char buf[11];
+    int i = 10;
+    buf[i] = 0;
+    do {
+        buf[--i] = (value % 10) + '0';
+        value /= 10;
+    } while (value > 0);
+    vga_puts(&buf[i]);
+}
+
+/* part/total as a percentage, without 64-bit division (no libgcc) */
+static uint32_t percent(uint32_t part, uint32_t total) {
+    if (total == 0) return 0;
+    if (part < 0xFFFFFFFF / 100) return part * 100 / total;
+    return part / (total / 100);
+}
+
+/* Bytes read per vfs_read call by 'view' */
+#define VIEW_CHUNK_SIZE 512
+
 /* Command buffer */
 static char input_buffer[SHELL_MAX_INPUT];
 static size_t input_pos = 0;
@@ -48,13 +71,20 @@ static void cmd_info(void);
 static void cmd_echo(const char* args);
 static void cmd_reboot(void);
 static void cmd_apex(const char* args);
-static void cmd_list(void);
+static void cmd_list(const char* args);
 static void cmd_view(const char* args);
 static void cmd_mkdir(const char* args);
 static void cmd_touch(const char* args);
 static void cmd_palette(void);
 static void cmd_date(void);
 static void cmd_calc(const char* args);
+static void cmd_lsblk(void);
+static void cmd_bcache(const char* args);
+static void cmd_sync(void);
+static void cmd_cachestat(void);
+static void cmd_iostat(void);
+static void cmd_fontbench(void);
+static void cmd_frames(const char* args);
 
 
 
@@ -91,7 +121,11 @@ static void process_command(void) {
     } else if (strncmp(input_buffer, "echo ", 5) == 0) {
         cmd_echo(input_buffer + 5);
     } else if (strcmp(input_buffer, "list") == 0 || strcmp(input_buffer, "ls") == 0) {
-        cmd_list();
+        cmd_list(NULL);
+    } else if (strncmp(input_buffer, "list ", 5) == 0) {
+        cmd_list(input_buffer + 5);
+    } else if (strncmp(input_buffer, "ls ", 3) == 0) {
+        cmd_list(input_buffer + 3);
     } else if (strncmp(input_buffer, "view ", 5) == 0) {
         cmd_view(input_buffer + 5);
     } else if (strncmp(input_buffer, "mkdir ", 6) == 0) {
@@ -104,6 +138,24 @@ static void process_command(void) {
         cmd_date();
     } else if (strncmp(input_buffer, "calc ", 5) == 0) {
         cmd_calc(input_buffer + 5);
+    } else if (strcmp(input_buffer, "lsblk") == 0) {
+        cmd_lsblk();
+    } else if (strcmp(input_buffer, "bcache") == 0) {
+        cmd_bcache(NULL);
+    } else if (strncmp(input_buffer, "bcache ", 7) == 0) {
+        cmd_bcache(input_buffer + 7);
+    } else if (strcmp(input_buffer, "sync") == 0) {
+        cmd_sync();
+    } else if (strcmp(input_buffer, "cachestat") == 0) {
+        cmd_cachestat();
+    } else if (strcmp(input_buffer, "iostat") == 0) {
+        cmd_iostat();
+    } else if (strcmp(input_buffer, "fontbench") == 0) {
+        cmd_fontbench();
+    } else if (strcmp(input_buffer, "frames") == 0) {
+        cmd_frames(NULL);
+    } else if (strncmp(input_buffer, "frames ", 7) == 0) {
+        cmd_frames(input_buffer + 7);
     } else if (strcmp(input_buffer, "echo") == 0) {
         vga_puts("\n");
     } else if (strncmp(input_buffer, "apex ", 5) == 0) {
@@ -143,13 +195,20 @@ static void cmd_help(void) {
     vga_puts("  clear, cls  - Clear the screen\n");
     vga_puts("  sys, info   - Show system information\n");
     vga_puts("  echo <text> - Print text to screen\n");
-    vga_puts("  list        - List directory contents (ls)\n");
-    vga_puts("  view <file> - View file contents (cat)\n");
+    vga_puts("  list [dir]  - List directory contents (ls)\n");
+    vga_puts("  view <path> - View file contents (cat)\n");
     vga_puts("  mkdir <dir> - Create directory\n");
     vga_puts("  touch <fil> - Create empty file\n");
     vga_puts("  palette     - Show system colors\n");
     vga_puts("  date        - Show current date/time (UTC)\n");
     vga_puts("  calc <expr> - Simple calculator (e.g. 10 + 20)\n");
+    vga_puts("  lsblk       - List block devices and I/O counters\n");
+    vga_puts("  bcache [n]  - Buffer cache stats (or resize to n buffers)\n");
+    vga_puts("  sync        - Write dirty buffers back to disk\n");
+    vga_puts("  cachestat   - File page cache stats and cached pages per file\n");
+    vga_puts("  iostat      - Request queue depth/latency histograms\n");
+    vga_puts("  fontbench   - Text rendering speed, glyphs per second\n");
+    vga_puts("  frames [hz] - Frame pacing stats (or set the refresh rate)\n");
     vga_puts("  apex <cmd>  - Execute command with elevated privileges\n");
     vga_puts("  mem         - Test memory allocation\n");
     vga_puts("  reboot      - Reboot the system\n");
@@ -158,36 +217,69 @@ static void cmd_help(void) {
 /* ... existing commands ... */
 
 #include "memory.h"
+#include "blockdev.h"
+#include "bcache.h"
+#include "blkqueue.h"
 #include "../fs/vfs.h"
+#include "../fs/pagecache.h"
+#include "vbe.h"
+#include "font.h"
+#include "cpu.h"
+#include "timer.h"
 
 /* ... existing code ... */
 
 /**
  * List directory command
  */
-static void cmd_list(void) {
+static void cmd_list(const char* args) {
     if (!fs_root) {
         vga_puts("[Error] No filesystem mounted.\n");
         return;
     }
-
-    uint32_t i = 0;
-    dirent_t* entry;
+    
+    const char* path = (args && *args) ? args : "/";
+    fs_node_t* node = vfs_lookup_path(path);
+    if (!node) {
+        vga_puts("Not found: ");
+        vga_puts(path);
+        vga_puts("\n");
+        return;
+    }
+    
+    vfs_dir_t* dir = vfs_opendir(node);
+    vfs_close(node); // the stream keeps its own reference
+    if (!dir) {
+        vga_puts("Not a directory.\n");
+        return;
+    }
     
     vga_set_color(vga_entry_color(VGA_LIGHT_BLUE, VGA_BLACK));
-    vga_puts("Directory listing for /:\n");
+    vga_puts("Directory listing for ");
+    vga_puts(path);
+    vga_puts(":\n");
     vga_set_color(vga_entry_color(VGA_WHITE, VGA_BLACK));
-
-    while ((entry = vfs_readdir(fs_root, i)) != 0) {
-        vga_puts("  ");
-        vga_puts(entry->name);
-        vga_puts("\n");
-        i++;
+    
+    dirent_t* entries = (dirent_t*)kmalloc(16 * sizeof(dirent_t));
+    uint32_t total = 0;
+    uint32_t count;
+    
+    while (entries && (count = vfs_readdir_batch(dir, entries, 16)) != 0) {
+        for (uint32_t i = 0; i < count; i++) {
+            vga_puts("  ");
+            vga_puts(entries[i].name);
+            if (entries[i].type == FS_DIRECTORY) vga_puts("/");
+            vga_puts("\n");
+        }
+        total += count;
     }
     
-    if (i == 0) {
+    if (total == 0) {
         vga_puts("  (empty)\n");
     }
+    
+    kfree(entries);
+    vfs_closedir(dir);
 }
 
 /**
@@ -195,7 +287,7 @@ static void cmd_list(void) {
  */
 static void cmd_view(const char* args) {
     if (args == NULL || *args == '\0') {
-        vga_puts("Usage: view <filename>\n");
+        vga_puts("Usage: view <path>\n");
         return;
     }
     
@@ -204,7 +296,7 @@ static void cmd_view(const char* args) {
         return;
     }
     
-    fs_node_t* file = vfs_finddir(fs_root, (char*)args);
+    fs_node_t* file = vfs_lookup_path(args);
     if (!file) {
         vga_puts("File not found: ");
         vga_puts(args);
@@ -214,7 +306,7 @@ static void cmd_view(const char* args) {
     
     if ((file->flags & 0x7) == FS_DIRECTORY) {
         vga_puts("Is a directory.\n");
-        kfree(file); // vfs_finddir allocates a new node
+        vfs_close(file); // vfs_finddir returns a referenced node
         return;
     }
     
@@ -222,25 +314,155 @@ static void cmd_view(const char* args) {
     uint32_t size = file->length;
     if (size == 0) {
         vga_puts("(empty file)\n");
-        kfree(file);
+        vfs_close(file);
         return;
     }
     
-    // Limit view size for now
-    if (size > 2048) {
-        vga_puts("[Warning] File too large, showing first 2KB only.\n");
-        size = 2048;
+    /* Memory-backed file in contiguous clusters: print it in place */
+    const uint8_t* mapped = vfs_map(file, 0, size);
+    if (mapped) {
+        for (uint32_t i = 0; i < size && mapped[i]; i++) vga_putchar((char)mapped[i]);
+        vga_puts("\n");
+        vfs_close(file);
+        return;
     }
     
-    uint8_t* buffer = kmalloc(size + 1);
-    uint32_t read = vfs_read(file, 0, size, buffer);
-    buffer[read] = 0; // Null terminate for printing
+    /* Stream the file in chunks; sequential reads let read-ahead kick in */
+    uint8_t* buffer = kmalloc(VIEW_CHUNK_SIZE + 1);
+    if (!buffer) {
+        vga_puts("[Error] Out of memory.\n");
+        vfs_close(file);
+        return;
+    }
     
-    vga_puts((char*)buffer);
+    uint32_t offset = 0;
+    while (offset < size) {
+        uint32_t read = vfs_read(file, offset, VIEW_CHUNK_SIZE, buffer);
+        if (read == 0) break;
+        buffer[read] = 0; // Null terminate for printing
+        vga_puts((char*)buffer);
+        offset += read;
+    }
     vga_puts("\n");
     
     kfree(buffer);
-    kfree(file);
+    vfs_close(file);
+}
+
+/**
+ * List block devices command
+ */
+static void cmd_lsblk(void) {
+    uint32_t count = blockdev_count();
+    if (count == 0) {
+        vga_puts("No block devices registered.\n");
+        return;
+    }
+    
+    for (uint32_t i = 0; i < count; i++) {
+        blockdev_t* dev = blockdev_get(i);
+        vga_puts("  ");
+        vga_puts(dev->name);
+        vga_puts(": ");
+        print_dec(dev->sector_count);
+        vga_puts(" sectors x ");
+        print_dec(dev->sector_size);
+        vga_puts(" bytes (");
+        print_dec(dev->sector_count / 2048);
+        vga_puts(" MB)\n");
+        vga_puts("    reads ");
+        print_dec(dev->read_ops);
+        vga_puts(" / ");
+        print_dec(dev->sectors_read);
+        vga_puts(" sectors, writes ");
+        print_dec(dev->write_ops);
+        vga_puts(" / ");
+        print_dec(dev->sectors_written);
+        vga_puts(" sectors, errors ");
+        print_dec(dev->errors);
+        vga_puts("\n");
+    }
+}
+
+/* Print the non-empty buckets of a log2 histogram */
+static void print_histogram(const char* label, const uint32_t* hist, const char* unit) {
+    vga_puts("    ");
+    vga_puts(label);
+    vga_puts(":");
+    for (uint32_t b = 0; b < BLKQ_HIST_BUCKETS; b++) {
+        if (hist[b] == 0) continue;
+        vga_puts(" [");
+        print_dec(1u << b);
+        vga_puts(unit);
+        vga_puts("]=");
+        print_dec(hist[b]);
+    }
+    vga_puts("\n");
+}
+
+/**
+ * Request queue statistics command
+ */
+static void cmd_iostat(void) {
+    for (uint32_t i = 0; i < blockdev_count(); i++) {
+        blockdev_t* dev = blockdev_get(i);
+        blkq_stats_t stats;
+        
+        vga_puts("  ");
+        vga_puts(dev->name);
+        if (!blkq_get_stats(dev, &stats)) {
+            vga_puts(": no request queue\n");
+            continue;
+        }
+        
+        vga_puts(": submitted ");
+        print_dec(stats.submitted);
+        vga_puts(", merged ");
+        print_dec(stats.merged);
+        vga_puts(", dispatched ");
+        print_dec(stats.dispatched);
+        vga_puts(", queued ");
+        print_dec(stats.depth);
+        vga_puts("\n");
+        print_histogram("depth", stats.depth_hist, "");
+        print_histogram("latency", stats.latency_hist, "K cyc");
+    }
+}
+
+/* Create a file or directory at 'path' (shared by mkdir and touch) */
+static void create_path(const char* path, uint32_t type) {
+    if (!fs_root) {
+        vga_puts("[Error] No filesystem mounted.\n");
+        return;
+    }
+    
+    char name[VFS_NAME_MAX + 1];
+    fs_node_t* dir = vfs_lookup_parent(path, name);
+    if (!dir) {
+        vga_puts("[Error] No such directory: ");
+        vga_puts(path);
+        vga_puts("\n");
+        return;
+    }
+    
+    /* touch on an existing file is fine, mkdir isn't */
+    fs_node_t* node = vfs_finddir(dir, name);
+    if (node) {
+        if (type == FS_DIRECTORY) vga_puts("[Error] Already exists.\n");
+        vfs_close(node);
+        vfs_close(dir);
+        return;
+    }
+    
+    node = vfs_create(dir, name, type);
+    if (!node) {
+        vga_puts("[Error] Could not create ");
+        vga_puts(path);
+        vga_puts(dir->create ? " (bad name or disk full)\n" : " (read-only filesystem)\n");
+    } else {
+        vfs_close(node);
+    }
+    vfs_close(dir);
 }
 
 /**
@@ -252,10 +474,7 @@ static void cmd_mkdir(const char* args) {
         return;
     }
     
-    vga_puts("Creating directory: ");
-    vga_puts(args);
-    vga_puts("\n");
-    /* TODO: VFS Implementation */
+    create_path(args, FS_DIRECTORY);
 }
 
 /**
@@ -267,10 +486,7 @@ static void cmd_touch(const char* args) {
         return;
     }
     
-    vga_puts("Creating file: ");
-    vga_puts(args);
-    vga_puts("\n");
-    /* TODO: VFS Implementation */
+    create_path(args, FS_FILE);
 }
 
 /**
@@ -454,6 +670,263 @@ static int atoi(const char* str) {
     return res;
 }
 
+/**
+ * Buffer cache statistics / resize command
+ */
+static void cmd_bcache(const char* args) {
+    if (args != NULL && *args != '\0') {
+        int count = atoi(args);
+        if (count <= 0 || bcache_init((uint32_t)count) != 0) {
+            vga_puts("Error: Could not resize buffer cache\n");
+            return;
+        }
+    }
+    
+    bcache_stats_t stats;
+    bcache_get_stats(&stats);
+    
+    uint32_t lookups = stats.hits + stats.misses;
+    
+    vga_puts("Buffer cache: ");
+    print_dec(stats.buffers);
+    vga_puts(" buffers (");
+    print_dec(stats.buffers * BCACHE_BLOCK_SIZE / 1024);
+    vga_puts(" KB), ");
+    print_dec(stats.in_use);
+    vga_puts(" in use, ");
+    print_dec(stats.dirty);
+    vga_puts(" dirty\n");
+    vga_puts("  hits ");
+    print_dec(stats.hits);
+    vga_puts(", misses ");
+    print_dec(stats.misses);
+    vga_puts(", hit rate ");
+    print_dec(percent(stats.hits, lookups));
+    vga_puts("%\n");
+    vga_puts("  evictions ");
+    print_dec(stats.evictions);
+    vga_puts(", writebacks ");
+    print_dec(stats.writebacks);
+    vga_puts("\n");
+    vga_puts("  read-ahead: ");
+    print_dec(stats.ra_issued);
+    vga_puts(" sectors prefetched, ");
+    print_dec(stats.ra_hits);
+    vga_puts(" used (");
+    print_dec(percent(stats.ra_hits, stats.ra_issued));
+    vga_puts("%)\n");
+}
+
+/**
+ * Sync command
+ */
+static void cmd_sync(void) {
+    /* File pages land in the buffer cache, which then goes to disk */
+    if (pagecache_sync(NULL) != 0 || bcache_sync(NULL) != 0) {
+        vga_puts("Error: Write-back failed\n");
+        return;
+    }
+    vga_puts("All dirty buffers written.\n");
+}
+
+/**
+ * Page cache statistics command
+ */
+static void cmd_cachestat(void) {
+    pagecache_stats_t stats;
+    pagecache_get_stats(&stats);
+    
+    vga_puts("Page cache: ");
+    print_dec(stats.pages);
+    vga_puts("/");
+    print_dec(stats.max_pages);
+    vga_puts(" pages (");
+    print_dec(stats.pages * PAGE_SIZE / 1024);
+    vga_puts(" KB), ");
+    print_dec(stats.dirty);
+    vga_puts(" dirty, ");
+    print_dec(stats.files);
+    vga_puts(" files\n");
+    vga_puts("  hits ");
+    print_dec(stats.hits);
+    vga_puts(", misses ");
+    print_dec(stats.misses);
+    vga_puts(", hit rate ");
+    print_dec(percent(stats.hits, stats.hits + stats.misses));
+    vga_puts("%\n");
+    vga_puts("  evictions ");
+    print_dec(stats.evictions);
+    vga_puts(", writebacks ");
+    print_dec(stats.writebacks);
+    vga_puts(", shrunk ");
+    print_dec(stats.shrunk);
+    vga_puts("\n");
+    
+    for (pc_file_t* file = pagecache_first_file(); file; file = file->next) {
+        uint32_t file_pages = (file->node->length + PAGE_SIZE - 1) / PAGE_SIZE;
+        vga_puts("  ");
+        vga_puts(file->node->name);
+        vga_puts(": ");
+        print_dec(file->count);
+        vga_puts("/");
+        print_dec(file_pages);
+        vga_puts(" pages");
+        if (file->dirty) {
+            vga_puts(", ");
+            print_dec(file->dirty);
+            vga_puts(" dirty");
+        }
+        vga_puts("\n");
+    }
+}
+
+/* 'count' events taking 'cycles' TSC ticks, as events per second */
+static uint32_t per_second(uint32_t count, uint64_t cycles, uint32_t per_us) {
+    /* Elapsed time in 10us units */
+    uint32_t div = per_us * 10;
+    while ((cycles >> 32) && div > 1) {
+        cycles >>= 1;
+        div >>= 1;
+    }
+    uint32_t units = (uint32_t)cycles / div;
+    if (units == 0) units = 1;
+    
+    if (count < 0xFFFFFFFF / 100000) return count * 100000 / units;
+    return count / units * 100000;
+}
+
+/* Baseline glyph, the way text used to be drawn: a bounds check and a
+ * 32-bit store per set font bit into a w x h target, no damage tracking */
+static void bitwise_char(uint32_t* target, int w, int h, int x, int y, char c, uint32_t color) {
+    uint8_t* glyph = font8x8_basic[(uint8_t)c & 127];
+    for (int i = 0; i < 8; i++) {
+        if (y + i < 0 || y + i >= h) continue;
+        uint32_t* row = target + (y + i) * w;
+        for (int j = 0; j < 8; j++) {
+            if ((glyph[i] & (1 << (7 - j))) && x + j >= 0 && x + j < w) {
+                row[x + j] = color;
+            }
+        }
+    }
+}
+
+/**
+ * Text rendering benchmark: fill the screen with text three times, with
+ * the old store-per-bit loop, with vbe_draw_char and as spans from the
+ * glyph cache
+ */
+static void cmd_fontbench(void) {
+    int cols = vbe_get_width() / 8;
+    int rows = vbe_get_height() / 8;
+    if (cols <= 0 || rows <= 0) {
+        vga_puts("Error: No graphics mode\n");
+        return;
+    }
+    if (cols > 255) cols = 255;
+    
+    uint32_t per_us = timer_tsc_per_us();
+    if (per_us == 0) {
+        vga_puts("Error: TSC not calibrated yet, try again in a second\n");
+        return;
+    }
+    
+    char line[256];
+    for (int i = 0; i < cols; i++) line[i] = 33 + i % 94;
+    line[cols] = '\0';
+    uint32_t glyphs = cols * rows;
+    
+    /* The old loop drew into a 32bpp backbuffer; time it on a scratch one */
+    int w = vbe_get_width(), h = vbe_get_height();
+    uint32_t* scratch = (uint32_t*)kmalloc(w * h * 4);
+    uint64_t baseline = 0;
+    uint64_t start;
+    bool have_baseline = scratch != NULL;
+    if (have_baseline) {
+        start = cpu_rdtsc();
+        for (int y = 0; y < rows; y++) {
+            for (int x = 0; x < cols; x++) {
+                bitwise_char(scratch, w, h, x * 8, y * 8, line[x], COLOR_WHITE);
+            }
+        }
+        baseline = cpu_rdtsc() - start;
+        kfree(scratch);
+    }
+    
+    start = cpu_rdtsc();
+    for (int y = 0; y < rows; y++) {
+        for (int x = 0; x < cols; x++) {
+            vbe_draw_char(x * 8, y * 8, line[x], COLOR_WHITE);
+        }
+    }
+    uint64_t bitwise = cpu_rdtsc() - start;
+    
+    start = cpu_rdtsc();
+    for (int y = 0; y < rows; y++) {
+        vbe_draw_text(0, y * 8, line, COLOR_WHITE, COLOR_BLACK);
+    }
+    uint64_t spans = cpu_rdtsc() - start;
+    vbe_swap();
+    
+    vga_puts("  before, store per bit:    ");
+    if (have_baseline) {
+        print_dec(per_second(glyphs, baseline, per_us));
+        vga_puts(" glyphs/s\n");
+    } else {
+        vga_puts("(no memory for a scratch buffer)\n");
+    }
+    vga_puts("  vbe_draw_char, per row:   ");
+    print_dec(per_second(glyphs, bitwise, per_us));
+    vga_puts(" glyphs/s\n");
+    vga_puts("  spans, glyph cache:       ");
+    print_dec(per_second(glyphs, spans, per_us));
+    vga_puts(" glyphs/s\n");
+}
+
+/**
+ * Frame pacing statistics / refresh rate command (0: present every draw)
+ */
+static void cmd_frames(const char* args) {
+    if (args != NULL && *args != '\0') {
+        int hz = atoi(args);
+        if (hz < 0 || (uint32_t)hz > timer_get_hz()) {
+            vga_puts("Error: Refresh rate must be 0 to ");
+            print_dec(timer_get_hz());
+            vga_puts(" Hz\n");
+            return;
+        }
+        vbe_set_refresh(hz);
+    }
+    
+    vbe_frame_stats_t stats;
+    vbe_get_frame_stats(&stats);
+    
+    vga_puts("Frame pacing: ");
+    if (stats.refresh_hz) {
+        print_dec(stats.refresh_hz);
+        vga_puts(" Hz on a ");
+        print_dec(timer_get_hz());
+        vga_puts(" Hz tick\n");
+    } else {
+        vga_puts("off, every draw presents\n");
+    }
+    vga_puts("  frames due ");
+    print_dec(stats.frames);
+    vga_puts(", presented ");
+    print_dec(stats.presented);
+    vga_puts(", dropped ");
+    print_dec(stats.dropped);
+    vga_puts(" (");
+    print_dec(percent(stats.dropped, stats.frames));
+    vga_puts("%)\n");
+    vga_puts("  present time: last ");
+    print_dec(stats.present_us_last);
+    vga_puts(" us, avg ");
+    print_dec(stats.timed ? stats.present_us_total / stats.timed : 0);
+    vga_puts(" us, max ");
+    print_dec(stats.present_us_max);
+    vga_puts(" us\n");
+}
+
 /**
  * Calculator command
  */
@@ -552,6 +1025,14 @@ void shell_run(void) {
     print_prompt();
     
     while (1) {
+        /* Finish queued file reads before blocking on the keyboard */
+        vfs_aio_poll();
+        
+        /* Keep the desktop moving (window drags) until a key arrives */
+        while (!keyboard_has_key()) {
+            ui_update();
+            __asm__ volatile("hlt");
+        }
         char c = keyboard_getchar();
         
         switch (c) {
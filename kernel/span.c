@@ -0,0 +1,203 @@
+/**
+ * OpenWare OS - Pixel Span Operations
+ * Copyright (c) 2026 Ventryx Inc. All rights reserved.
+ */
+
+#include "span.h"
+#include "cpu.h"
+
+/* Four pixels in an XMM register (aligned, and unaligned for loads) */
+typedef uint32_t v4u32 __attribute__((vector_size(16)));
+typedef uint32_t v4u32_unaligned __attribute__((vector_size(16), aligned(4)));
+
+/* Eight 16-bit lanes, one color channel each while blending */
+typedef uint16_t v8u16 __attribute__((vector_size(16)));
+
+/* Spans shorter than this aren't worth the alignment prologue */
+#define SPAN_SSE_MIN    16
+
+CPU_SSE2_FN static void fill_sse2(uint32_t* dst, uint32_t color, uint32_t n) {
+    // Scalar up to a 16-byte boundary, then 16 pixels per iteration
+    while (((uint32_t)dst & 15) && n) {
+        *dst++ = color;
+        n--;
+    }
+    
+    v4u32 v = { color, color, color, color };
+    v4u32* out = (v4u32*)dst;
+    for (; n >= 16; n -= 16, out += 4) {
+        out[0] = v;
+        out[1] = v;
+        out[2] = v;
+        out[3] = v;
+    }
+    for (; n >= 4; n -= 4) *out++ = v;
+    
+    dst = (uint32_t*)out;
+    while (n--) *dst++ = color;
+}
+
+CPU_SSE2_FN static void copy_sse2(uint32_t* dst, const uint32_t* src, uint32_t n) {
+    // Align the stores; the loads may stay unaligned
+    while (((uint32_t)dst & 15) && n) {
+        *dst++ = *src++;
+        n--;
+    }
+    
+    for (; n >= 8; n -= 8, dst += 8, src += 8) {
+        v4u32 a = *(const v4u32_unaligned*)src;
+        v4u32 b = *(const v4u32_unaligned*)(src + 4);
+        *(v4u32*)dst = a;
+        *(v4u32*)(dst + 4) = b;
+    }
+    while (n--) *dst++ = *src++;
+}
+
+/* Copy from the end backwards, for a destination overlapping above the source */
+CPU_SSE2_FN static void copy_back_sse2(uint32_t* dst, const uint32_t* src, uint32_t n) {
+    dst += n;
+    src += n;
+    while (((uint32_t)dst & 15) && n) {
+        *--dst = *--src;
+        n--;
+    }
+    
+    // Each block is loaded before it is stored, so overlap is harmless
+    for (; n >= 4; n -= 4) {
+        dst -= 4;
+        src -= 4;
+        v4u32 a = *(const v4u32_unaligned*)src;
+        *(v4u32*)dst = a;
+    }
+    while (n--) *--dst = *--src;
+}
+
+/*
+ * Blending works on two channels at once: red and blue in the 16-bit halves
+ * of (pixel & 0x00FF00FF), green alone in (pixel >> 8) & 0xFF. Each half
+ * holds src * a + dst * (255 - a), at most 255 * 255, and is divided by 255
+ * with rounding as (t + (t >> 8)) >> 8 where t = x + 128. The SSE2 code does
+ * the same arithmetic in 16-bit lanes, so both paths give identical pixels.
+ */
+static inline uint32_t div255_pair(uint32_t x) {
+    x += 0x00800080;
+    return ((x + ((x >> 8) & 0x00FF00FF)) >> 8) & 0x00FF00FF;
+}
+
+static inline uint32_t blend_pixel(uint32_t dst, uint32_t src, uint32_t a) {
+    uint32_t ia = 255 - a;
+    uint32_t rb = (src & 0x00FF00FF) * a + (dst & 0x00FF00FF) * ia;
+    uint32_t g = ((src >> 8) & 0xFF) * a + ((dst >> 8) & 0xFF) * ia;
+    return div255_pair(rb) | (div255_pair(g) << 8);
+}
+
+/* Four pixels: 'src_rb' and 'src_g' are the source channels already times alpha */
+CPU_SSE2_FN static inline v4u32 blend4(v4u32 dst, v8u16 src_rb, v8u16 src_g, v8u16 ia) {
+    v8u16 rb = (v8u16)(dst & 0x00FF00FF) * ia + src_rb + 128;
+    v8u16 g = (v8u16)((dst >> 8) & 0xFF) * ia + src_g + 128;
+    rb = (rb + (rb >> 8)) >> 8;
+    g = (g + (g >> 8)) >> 8;
+    return (v4u32)rb | ((v4u32)g << 8);
+}
+
+CPU_SSE2_FN static void blend_fill_sse2(uint32_t* dst, uint32_t color, uint32_t n) {
+    uint16_t a = color >> 24;
+    v4u32 c = { color, color, color, color };
+    v8u16 src_rb = (v8u16)(c & 0x00FF00FF) * a;
+    v8u16 src_g = (v8u16)((c >> 8) & 0xFF) * a;
+    v8u16 ia = (v8u16){ 0 } + (uint16_t)(255 - a);
+    
+    for (; n >= 4; n -= 4, dst += 4) {
+        v4u32_unaligned* p = (v4u32_unaligned*)dst;
+        *p = blend4(*p, src_rb, src_g, ia);
+    }
+    for (; n; n--, dst++) *dst = blend_pixel(*dst, color, a);
+}
+
+CPU_SSE2_FN static void blend_sse2(uint32_t* dst, const uint32_t* src, uint32_t n) {
+    for (; n >= 4; n -= 4, dst += 4, src += 4) {
+        v4u32 s = *(const v4u32_unaligned*)src;
+        v4u32 a32 = s >> 24;
+        v8u16 a = (v8u16)(a32 | (a32 << 16));       // Alpha in both lanes of a pixel
+        v4u32_unaligned* p = (v4u32_unaligned*)dst;
+        *p = blend4(*p, (v8u16)(s & 0x00FF00FF) * a, (v8u16)((s >> 8) & 0xFF) * a, 255 - a);
+    }
+    for (; n; n--, dst++, src++) *dst = blend_pixel(*dst, *src, *src >> 24);
+}
+
+void span_fill32(uint32_t* dst, uint32_t color, uint32_t n) {
+    if (n >= SPAN_SSE_MIN && cpu_has_sse2()) {
+        fill_sse2(dst, color, n);
+        return;
+    }
+    __asm__ volatile("cld; rep stosl" : "+D"(dst), "+c"(n) : "a"(color) : "memory");
+}
+
+void span_copy32(uint32_t* dst, const uint32_t* src, uint32_t n) {
+    if (n >= SPAN_SSE_MIN && cpu_has_sse2()) {
+        copy_sse2(dst, src, n);
+        return;
+    }
+    __asm__ volatile("cld; rep movsl" : "+D"(dst), "+S"(src), "+c"(n) : : "memory");
+}
+
+void span_move32(uint32_t* dst, const uint32_t* src, uint32_t n) {
+    // Forward is safe unless the destination starts inside the source
+    if (dst <= src || dst >= src + n) {
+        span_copy32(dst, src, n);
+        return;
+    }
+    
+    if (n >= SPAN_SSE_MIN && cpu_has_sse2()) {
+        copy_back_sse2(dst, src, n);
+        return;
+    }
+    while (n--) dst[n] = src[n];
+}
+
+void span_copy(void* dst, const void* src, uint32_t bytes) {
+    uint8_t* d = (uint8_t*)dst;
+    const uint8_t* s = (const uint8_t*)src;
+    uint32_t words = bytes / 4;
+    
+    span_copy32((uint32_t*)d, (const uint32_t*)s, words);
+    for (uint32_t i = words * 4; i < bytes; i++) d[i] = s[i];
+}
+
+void span_move(void* dst, const void* src, uint32_t bytes) {
+    uint8_t* d = (uint8_t*)dst;
+    const uint8_t* s = (const uint8_t*)src;
+    uint32_t words = bytes / 4;
+    
+    if (d <= s || d >= s + bytes) {
+        span_copy(dst, src, bytes);
+        return;
+    }
+    
+    // Backwards: the odd tail bytes first, then the words
+    for (uint32_t i = bytes; i > words * 4; i--) d[i - 1] = s[i - 1];
+    span_move32((uint32_t*)d, (const uint32_t*)s, words);
+}
+
+void span_blend_fill32(uint32_t* dst, uint32_t color, uint32_t n) {
+    uint32_t a = color >> 24;
+    if (a == 0) return;
+    if (a == 255) {
+        span_fill32(dst, color & 0x00FFFFFF, n);
+        return;
+    }
+    
+    if (n >= 4 && cpu_has_sse2()) {
+        blend_fill_sse2(dst, color, n);
+        return;
+    }
+    for (; n; n--, dst++) *dst = blend_pixel(*dst, color, a);
+}
+
+void span_blend32(uint32_t* dst, const uint32_t* src, uint32_t n) {
+    if (n >= 4 && cpu_has_sse2()) {
+        blend_sse2(dst, src, n);
+        return;
+    }
+    for (; n; n--, dst++, src++) *dst = blend_pixel(*dst, *src, *src >> 24);
+}
@@ -0,0 +1,64 @@
+/**
+ * OpenWare OS - Off-screen Surfaces
+ * Copyright (c) 2026 Ventryx Inc. All rights reserved.
+ */
+
+#include "surface.h"
+#include "memory.h"
+#include "span.h"
+#include "font.h"
+
+surface_t* surface_create(int w, int h) {
+    if (w <= 0 || h <= 0) return NULL;
+    
+    surface_t* surface = (surface_t*)kmalloc(sizeof(surface_t));
+    if (!surface) return NULL;
+    
+    surface->pixels = (uint32_t*)kmalloc((size_t)w * h * sizeof(uint32_t));
+    if (!surface->pixels) {
+        kfree(surface);
+        return NULL;
+    }
+    surface->w = w;
+    surface->h = h;
+    return surface;
+}
+
+void surface_destroy(surface_t* surface) {
+    if (!surface) return;
+    kfree(surface->pixels);
+    kfree(surface);
+}
+
+void surface_fill_rect(surface_t* surface, int x, int y, int w, int h, uint32_t color) {
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    if (x + w > surface->w) w = surface->w - x;
+    if (y + h > surface->h) h = surface->h - y;
+    if (w <= 0 || h <= 0) return;
+    
+    uint32_t* row = surface->pixels + y * surface->w + x;
+    for (int i = 0; i < h; i++, row += surface->w) {
+        span_fill32(row, color, (uint32_t)w);
+    }
+}
+
+// Set pixels only, leaving the background as it is
+void surface_draw_string(surface_t* surface, int x, int y, const char* str, uint32_t color) {
+    for (; *str; str++, x += 8) {
+        if (x >= surface->w) break;
+        if (x + 8 <= 0) continue;
+        
+        uint8_t* glyph = font8x8_basic[(uint8_t)*str & 0x7F];
+        for (int i = 0; i < 8; i++) {
+            int py = y + i;
+            if (py < 0 || py >= surface->h || !glyph[i]) continue;
+            
+            uint32_t* row = surface->pixels + py * surface->w;
+            for (int j = 0; j < 8; j++) {
+                int px = x + j;
+                if ((glyph[i] & (0x80 >> j)) && px >= 0 && px < surface->w) row[px] = color;
+            }
+        }
+    }
+}
@@ -0,0 +1,77 @@
+/**
+ * OpenWare OS - Programmable Interval Timer
+ * Copyright (c) 2026 Ventryx Inc. All rights reserved.
+ */
+
+#include "timer.h"
+#include "irq.h"
+#include "cpu.h"
+#include "pic.h"
+
+static volatile uint32_t ticks = 0;
+static uint32_t timer_hz = 0;
+static timer_hook_t tick_hook = NULL;
+
+static uint64_t tsc_start;
+static uint32_t tsc_per_us = 0;
+
+static inline void outb(uint16_t port, uint8_t val) {
+    __asm__ volatile("outb %0, %1" : : "a"(val), "Nd"(port));
+}
+
+static inline uint8_t inb(uint16_t port) {
+    uint8_t ret;
+    __asm__ volatile("inb %1, %0" : "=a"(ret) : "Nd"(port));
+    return ret;
+}
+
+static void timer_irq_handler(registers_t* regs) {
+    (void)regs;
+    ticks++;
+    
+    // Time the TSC over one second of ticks, starting on a tick edge
+    if (ticks == 1) {
+        tsc_start = cpu_rdtsc();
+    } else if (ticks == 1 + timer_hz) {
+        // Cycles in one second / 1000000, as (cycles / 16) / 62500 so no 64-bit divide is needed
+        tsc_per_us = (uint32_t)((cpu_rdtsc() - tsc_start) >> 4) / 62500;
+    }
+    
+    if (tick_hook) tick_hook();
+}
+
+/**
+ * Program channel 0 to interrupt 'hz' times a second
+ */
+void timer_init(uint32_t hz) {
+    uint32_t divisor = PIT_BASE_HZ / hz;
+    if (divisor > 0xFFFF) divisor = 0xFFFF;
+    if (divisor < 1) divisor = 1;
+    
+    timer_hz = hz;
+    ticks = 0;
+    irq_register_handler(0, timer_irq_handler);
+    
+    outb(PIT_COMMAND, PIT_MODE_RATE);
+    outb(PIT_CHANNEL0, divisor & 0xFF);
+    outb(PIT_CHANNEL0, divisor >> 8);
+    
+    // The BIOS usually leaves IRQ0 unmasked, but don't count on it
+    outb(PIC1_DATA, inb(PIC1_DATA) & ~0x01);
+}
+
+uint32_t timer_ticks(void) {
+    return ticks;
+}
+
+uint32_t timer_get_hz(void) {
+    return timer_hz;
+}
+
+void timer_set_hook(timer_hook_t hook) {
+    tick_hook = hook;
+}
+
+uint32_t timer_tsc_per_us(void) {
+    return tsc_per_us;
+}
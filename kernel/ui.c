@@ -1,19 +1,63 @@
 #include "ui.h"
 #include "vbe.h"
 #include "memory.h"
+#include "region.h"
 
 static window_t* windows[MAX_WINDOWS];
 static int window_count = 0;
 
+// Window ids from the bottom of the stack to the top
+static int z_order[MAX_WINDOWS];
+
+// Latest pointer state from the mouse driver, consumed once per frame
+static volatile int pointer_x = 0, pointer_y = 0;  // The mouse driver starts at 0, 0
+static volatile bool pointer_down;
+static volatile bool pointer_pressed;           // Button went down since the last frame
+static volatile int press_x, press_y;
+
+static window_t* drag_window = NULL;
+static int drag_dx, drag_dy;                    // Pointer position within the dragged window
+
+// Screen areas that must be composited on the next ui_render
+static region_t damage;
+
+static void damage_rect(int x, int y, int w, int h) {
+    vbe_rect_t screen = { 0, 0, vbe_get_width(), vbe_get_height() };
+    vbe_rect_t r = { x, y, w, h };
+    if (rect_intersect(&r, &screen, &r)) region_add(&damage, &r);
+}
+
+// Everything a window covers on screen, shadow included
+static void damage_window(window_t* win) {
+    damage_rect(win->x, win->y, win->w + UI_SHADOW_OFFSET, win->h + UI_SHADOW_OFFSET);
+}
+
 void ui_init(void) {
     for (int i = 0; i < MAX_WINDOWS; i++) windows[i] = NULL;
     window_count = 0;
+    
+    pointer_down = false;
+    pointer_pressed = false;
+    drag_window = NULL;
+    
+    vbe_set_cursor(pointer_x, pointer_y);
+    vbe_show_cursor(1);
+    
+    region_clear(&damage);
+    damage_rect(0, 0, vbe_get_width(), vbe_get_height());
 }
 
 int ui_create_window(int x, int y, int w, int h, const char* title, uint32_t color) {
     if (window_count >= MAX_WINDOWS) return -1;
     
     window_t* win = (window_t*)kmalloc(sizeof(window_t));
+    if (!win) return -1;
+    
+    win->surface = surface_create(w, h);
+    if (!win->surface) {
+        kfree(win);
+        return -1;
+    }
     win->x = x;
     win->y = y;
     win->w = w;
@@ -22,38 +66,271 @@ int ui_create_window(int x, int y, int w, int h, const char* title, uint32_t col
     win->color = color;
     win->visible = true;
     win->dragging = false;
+    win->content_dirty = true;
     
+    z_order[window_count] = window_count;
     windows[window_count++] = win;
+    damage_window(win);
     return window_count - 1;
 }
 
-static void draw_window(window_t* win) {
-    if (!win->visible) return;
+/**
+ * Mark a window's content as changed. Its surface is redrawn and copied
+ * to the screen on the next ui_render; nothing else is touched.
+ */
+void ui_invalidate_window(int id) {
+    if (id < 0 || id >= window_count || !windows[id]) return;
+    windows[id]->content_dirty = true;
+}
+
+// Redraw the frame and content of a window into its surface
+static void paint_window(window_t* win) {
+    surface_t* s = win->surface;
+    
+    // Border & Background
+    surface_fill_rect(s, 0, 0, win->w, win->h, COLOR_GRAY);
+    surface_fill_rect(s, 2, 20, win->w - 4, win->h - 22, win->color);
     
-    // Draw Shadow (Simple offset)
-    vbe_draw_rect(win->x + 4, win->y + 4, win->w, win->h, 0x00222222);
+    // Title Bar
+    surface_fill_rect(s, 2, 2, win->w - 4, UI_TITLE_HEIGHT, UI_TITLE_COLOR);
+    surface_draw_string(s, 10, 5, win->title, COLOR_WHITE);
+}
+
+// Back-to-front repaint of one area, for when the visible pieces can't be tracked exactly
+static void compose_painter(const vbe_rect_t* area) {
+    vbe_set_clip(area->x, area->y, area->w, area->h);
+    vbe_draw_rect(area->x, area->y, area->w, area->h, UI_BACKGROUND);
+    for (int i = 0; i < window_count; i++) {
+        window_t* win = windows[z_order[i]];
+        if (!win || !win->visible) continue;
+        vbe_blend_rect(win->x + UI_SHADOW_OFFSET, win->y + UI_SHADOW_OFFSET, win->w, win->h, UI_SHADOW_COLOR);
+        vbe_blit(win->x, win->y, win->surface->pixels, win->w, win->w, win->h);
+    }
+    vbe_reset_clip();
+}
+
+/**
+ * Composite one damaged area front to back. Each window draws only the
+ * part of the area still uncovered by the windows above it, which is then
+ * cut away; once nothing is left the windows further down are skipped
+ * entirely, and whatever remains at the end is desktop background.
+ * Shadows are translucent, so they cover nothing: their visible pieces are
+ * blended last, lowest first, over what was drawn beneath them.
+ */
+static void compose(const vbe_rect_t* area) {
+    region_t todo;
+    todo.rects[0] = *area;
+    todo.count = 1;
+    
+    vbe_rect_t shadows[REGION_MAX];
+    int shadow_count = 0;
     
-    // Draw Border & Background
-    vbe_draw_rect(win->x, win->y, win->w, win->h, COLOR_GRAY);
-    vbe_draw_rect(win->x + 2, win->y + 20, win->w - 4, win->h - 22, win->color);
+    for (int i = window_count - 1; i >= 0 && todo.count; i--) {
+        window_t* win = windows[z_order[i]];
+        if (!win || !win->visible) continue;
+        
+        vbe_rect_t body = { win->x, win->y, win->w, win->h };
+        vbe_rect_t shadow = { win->x + UI_SHADOW_OFFSET, win->y + UI_SHADOW_OFFSET, win->w, win->h };
+        vbe_rect_t part;
+        
+        for (int j = 0; j < todo.count; j++) {
+            if (!rect_intersect(&todo.rects[j], &body, &part)) continue;
+            vbe_set_clip(part.x, part.y, part.w, part.h);
+            vbe_blit(win->x, win->y, win->surface->pixels, win->w, win->w, win->h);
+        }
+        if (!region_subtract(&todo, &body)) goto fallback;
+        
+        // The shadow shows only where the window itself doesn't
+        for (int j = 0; j < todo.count; j++) {
+            if (!rect_intersect(&todo.rects[j], &shadow, &part)) continue;
+            if (shadow_count == REGION_MAX) goto fallback;
+            shadows[shadow_count++] = part;
+        }
+    }
+    vbe_reset_clip();
     
-    // Draw Title Bar
-    vbe_draw_rect(win->x + 2, win->y + 2, win->w - 4, 18, 0x00336699);
-    vbe_draw_string(win->x + 10, win->y + 5, win->title, COLOR_WHITE);
+    for (int j = 0; j < todo.count; j++) {
+        vbe_rect_t* r = &todo.rects[j];
+        vbe_draw_rect(r->x, r->y, r->w, r->h, UI_BACKGROUND);
+    }
+    while (shadow_count--) {
+        vbe_rect_t* r = &shadows[shadow_count];
+        vbe_blend_rect(r->x, r->y, r->w, r->h, UI_SHADOW_COLOR);
+    }
+    return;
+    
+fallback:
+    compose_painter(area);
 }
 
+/**
+ * Bring the drawing target up to date: redraw the surfaces of windows
+ * whose content changed and composite only the damaged areas. They reach
+ * the screen on the next vbe_present.
+ */
 void ui_render(void) {
-    vbe_clear(0x00003366); // Background
-    
-    // Draw all windows back-to-front
     for (int i = 0; i < window_count; i++) {
-        if (windows[i]) draw_window(windows[i]);
+        window_t* win = windows[i];
+        if (!win || !win->content_dirty) continue;
+        
+        paint_window(win);
+        win->content_dirty = false;
+        if (win->visible) damage_rect(win->x, win->y, win->w, win->h);
     }
     
-    vbe_swap();
+    for (int i = 0; i < damage.count; i++) {
+        compose(&damage.rects[i]);
+    }
+    region_clear(&damage);
 }
 
+/**
+ * Pointer event from the mouse driver. Only the state is recorded here;
+ * ui_update acts on the latest of it, so any number of packets between
+ * two frames costs one window move.
+ */
 void ui_handle_mouse(int x, int y, bool clicked) {
-    (void)x; (void)y; (void)clicked;
-    // Logic for dragging and clicking...
+    pointer_x = x;
+    pointer_y = y;
+    if (clicked && !pointer_down) {
+        pointer_pressed = true;
+        press_x = x;
+        press_y = y;
+    }
+    pointer_down = clicked;
+}
+
+// Position in the stack of the topmost visible window under a point, or -1
+static int window_at(int x, int y) {
+    for (int i = window_count - 1; i >= 0; i--) {
+        window_t* win = windows[z_order[i]];
+        if (win && win->visible && x >= win->x && x < win->x + win->w &&
+            y >= win->y && y < win->y + win->h) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Move the window at stack position 'pos' to the top
+static void raise_window(int pos) {
+    if (pos == window_count - 1) return;
+    
+    int id = z_order[pos];
+    for (int i = pos; i < window_count - 1; i++) {
+        z_order[i] = z_order[i + 1];
+    }
+    z_order[window_count - 1] = id;
+    damage_window(windows[id]);
+}
+
+// Add what is left of 'rect' after taking 'cut' out of it to the damage
+static void damage_outside(const vbe_rect_t* rect, const vbe_rect_t* cut) {
+    region_t rest;
+    rest.rects[0] = *rect;
+    rest.count = 1;
+    region_subtract(&rest, cut);    // One rectangle leaves at most four
+    for (int i = 0; i < rest.count; i++) {
+        damage_rect(rest.rects[i].x, rest.rects[i].y, rest.rects[i].w, rest.rects[i].h);
+    }
+}
+
+static bool damage_overlaps(const vbe_rect_t* rect) {
+    vbe_rect_t part;
+    for (int i = 0; i < damage.count; i++) {
+        if (rect_intersect(&damage.rects[i], rect, &part)) return true;
+    }
+    return false;
+}
+
+/**
+ * Move a window. When it is on top and already correct on screen, its
+ * pixels are copied to the new place with vbe_copy_rect and only the
+ * uncovered area, the new shadow and any part that was off screen get
+ * composited; otherwise the old and new areas are simply damaged.
+ */
+static void move_window(window_t* win, int x, int y) {
+    if (x == win->x && y == win->y) return;
+    
+    vbe_rect_t old = { win->x, win->y, win->w, win->h };
+    vbe_rect_t old_shadow = { win->x + UI_SHADOW_OFFSET, win->y + UI_SHADOW_OFFSET, win->w, win->h };
+    bool on_top = windows[z_order[window_count - 1]] == win;
+    bool copy = win->visible && on_top && !win->content_dirty && !damage_overlaps(&old);
+    
+    win->x = x;
+    win->y = y;
+    if (!win->visible) return;
+    
+    vbe_rect_t body = { x, y, win->w, win->h };
+    vbe_rect_t shadow = { x + UI_SHADOW_OFFSET, y + UI_SHADOW_OFFSET, win->w, win->h };
+    damage_outside(&old, &body);
+    damage_outside(&old_shadow, &body);
+    damage_outside(&shadow, &body);
+    
+    if (!copy) {
+        damage_rect(body.x, body.y, body.w, body.h);
+        return;
+    }
+    
+    vbe_copy_rect(old.x, old.y, x, y, win->w, win->h);
+    
+    // Only the part that was on screen could be copied
+    vbe_rect_t screen = { 0, 0, vbe_get_width(), vbe_get_height() };
+    vbe_rect_t copied;
+    if (rect_intersect(&old, &screen, &copied)) {
+        copied.x += x - old.x;
+        copied.y += y - old.y;
+        damage_outside(&body, &copied);
+    } else {
+        damage_rect(body.x, body.y, body.w, body.h);
+    }
+}
+
+/**
+ * Run one frame once it is due: act on the pointer state gathered since
+ * the last one (a press in a title bar raises the window and starts a
+ * drag, motion moves it, release ends it), move the cursor, composite
+ * whatever changed and present it together with any other drawing
+ */
+void ui_update(void) {
+    if (!vbe_frame_ready()) return;
+    
+    __asm__ volatile("cli");
+    int x = pointer_x, y = pointer_y;
+    bool down = pointer_down, pressed = pointer_pressed;
+    int px = press_x, py = press_y;
+    pointer_pressed = false;
+    __asm__ volatile("sti");
+    
+    if (pressed && !drag_window) {
+        int pos = window_at(px, py);
+        if (pos >= 0) {
+            window_t* win = windows[z_order[pos]];
+            raise_window(pos);
+            if (py < win->y + 2 + UI_TITLE_HEIGHT) {
+                win->dragging = true;
+                drag_window = win;
+                drag_dx = px - win->x;
+                drag_dy = py - win->y;
+            }
+        }
+    }
+    
+    if (drag_window) {
+        move_window(drag_window, x - drag_dx, y - drag_dy);
+        if (!down) {
+            drag_window->dragging = false;
+            drag_window = NULL;
+        }
+    }
+    
+    bool changed = damage.count > 0;
+    for (int i = 0; i < window_count && !changed; i++) {
+        if (windows[i] && windows[i]->content_dirty) changed = true;
+    }
+    if (changed) ui_render();
+    
+    // A cursor move alone costs its two small rectangles in the swap
+    vbe_set_cursor(x, y);
+    vbe_present();
 }
@@ -2,17 +2,175 @@
 #include "font.h"
 #include "memory.h"
 #include "types.h"
+#include "span.h"
+#include "pixfmt.h"
+#include "region.h"
+#include "cpu.h"
+#include "timer.h"
 
 
 // Pointer to the mode info block stored by the bootloader at 0x5000
 static vbe_mode_info_t* vbe_info = (vbe_mode_info_t*)0x5000;
 
-static uint32_t* framebuffer = NULL;
+static uint8_t* framebuffer = NULL;
+static uint8_t* backbuffer = NULL;      // Rows of back_pitch bytes, no padding
+static uint32_t back_pitch = 0;
 static uint32_t screen_width = 0;
 static uint32_t screen_height = 0;
 
+// Layout of the framebuffer pixels; every buffer we draw to uses it
+static const pixfmt_t* fmt = NULL;
+static uint32_t bytes_pp = 0;
+
 static int term_x = 0;
 static int term_y = 0;
+static uint32_t term_bg = 0x00003366;   // Console background (OpenWare blue)
+
+/*
+ * Glyphs expanded to 8x8 framebuffer pixels for one foreground/background
+ * pair, so opaque text is drawn by copying rows. Each glyph is expanded on
+ * first use.
+ */
+typedef struct {
+    uint32_t fg, bg;
+    uint32_t last_used;                 // 0: slot unused
+    uint32_t valid[4];                  // Bit per glyph already expanded
+} glyph_slot_t;
+
+// Screen pixels in 0x00RRGGBB while they are blended, for formats that aren't
+static uint32_t blend_pixels[VBE_BLEND_CHUNK];
+
+static glyph_slot_t glyph_slots[VBE_GLYPH_SLOTS];
+static uint8_t glyph_pixels[VBE_GLYPH_SLOTS][128 * 64 * 4];
+static uint32_t glyph_clock = 0;
+
+// Regions of the backbuffer changed since the last vbe_swap
+static region_t dirty;
+
+// Drawing outside this rectangle is discarded
+static vbe_rect_t clip;
+
+/*
+ * Pointer sprite ('X' outline, '.' fill, ' ' transparent). It is drawn by
+ * vbe_swap after everything else, over a save-under copy of the pixels it
+ * covers. When drawing is buffered the sprite only sits in the drawing
+ * target while it is presented, so draw calls never see it; otherwise it
+ * stays on screen between swaps.
+ */
+static const char* const cursor_sprite[VBE_CURSOR_H] = {
+    "X           ",
+    "XX          ",
+    "X.X         ",
+    "X..X        ",
+    "X...X       ",
+    "X....X      ",
+    "X.....X     ",
+    "X......X    ",
+    "X.......X   ",
+    "X........X  ",
+    "X.........X ",
+    "X......XXXXX",
+    "X...X..X    ",
+    "X..XX..X    ",
+    "X.X  X..X   ",
+    "XX   X..X   ",
+    "X     X..X  ",
+    "      X..X  ",
+    "       XX   ",
+};
+
+static bool cursor_visible = false;
+static int cursor_x = 0, cursor_y = 0;          // Requested position
+static bool cursor_drawn = false;               // Sprite is in the drawing target
+static vbe_rect_t cursor_under;                 // Area the save-under holds
+static uint8_t cursor_save[VBE_CURSOR_W * VBE_CURSOR_H * 4];
+static bool cursor_shown = false;               // Buffered: sprite is on screen at shown_x/y
+static int shown_x, shown_y;
+
+/*
+ * Hardware display start (Bochs/QEMU DISPI). Video memory is split into
+ * one or two pages of page_rows rows each; the screen shows screen_height
+ * rows starting at scroll_y inside the front page. With two pages we draw
+ * into the hidden one and flip, instead of keeping a backbuffer in RAM.
+ */
+static bool hw_start = false;
+static uint32_t virt_rows = 0;          // Rows of video memory
+static uint32_t page_rows = 0;
+static int page_count = 1;
+static int front_page = 0;
+static int draw_page = 0;
+static uint32_t scroll_y = 0;
+
+/*
+ * Frame pacing. The timer tick advances a phase accumulator by refresh_hz
+ * and a frame falls due each time it wraps past the tick rate. Draw calls
+ * only add damage; whoever sees vbe_frame_ready() presents it all at once.
+ */
+static uint32_t refresh_hz = 0;         // 0: every caller presents at once
+static uint32_t frame_phase = 0;
+static volatile bool frame_due = false;
+static vbe_frame_stats_t frame_stats;
+
+static inline void outw(uint16_t port, uint16_t data) {
+    __asm__ volatile("outw %0, %1" : : "a"(data), "Nd"(port));
+}
+
+static inline uint16_t inw(uint16_t port) {
+    uint16_t ret;
+    __asm__ volatile("inw %1, %0" : "=a"(ret) : "Nd"(port));
+    return ret;
+}
+
+static uint16_t dispi_read(uint16_t index) {
+    outw(VBE_DISPI_IOPORT_INDEX, index);
+    return inw(VBE_DISPI_IOPORT_DATA);
+}
+
+static void dispi_write(uint16_t index, uint16_t value) {
+    outw(VBE_DISPI_IOPORT_INDEX, index);
+    outw(VBE_DISPI_IOPORT_DATA, value);
+}
+
+/**
+ * Check that the mode the bootloader set is driven by the DISPI interface
+ * and learn how many rows of video memory it lets us address
+ */
+static void dispi_detect(void) {
+    uint16_t id = dispi_read(VBE_DISPI_INDEX_ID);
+    if (id < VBE_DISPI_ID0 || id > VBE_DISPI_ID5) return;
+    
+    if (!(dispi_read(VBE_DISPI_INDEX_ENABLE) & VBE_DISPI_ENABLED)) return;
+    if (dispi_read(VBE_DISPI_INDEX_XRES) != screen_width ||
+        dispi_read(VBE_DISPI_INDEX_YRES) != screen_height ||
+        dispi_read(VBE_DISPI_INDEX_BPP) != vbe_info->bpp) return;
+    
+    // Our rows must be laid out exactly as the card scans them
+    if (dispi_read(VBE_DISPI_INDEX_VIRT_WIDTH) * bytes_pp != vbe_info->pitch) return;
+    
+    // The card derives the virtual height from its memory size
+    uint32_t rows = dispi_read(VBE_DISPI_INDEX_VIRT_HEIGHT);
+    if (rows < screen_height) return;
+    
+    virt_rows = rows;
+    page_rows = rows;
+    hw_start = true;
+    dispi_write(VBE_DISPI_INDEX_X_OFFSET, 0);
+    dispi_write(VBE_DISPI_INDEX_Y_OFFSET, 0);
+}
+
+static inline uint8_t* vram_row(int page, uint32_t row) {
+    return framebuffer + (page * page_rows + row) * vbe_info->pitch;
+}
+
+// Point the display at the front page
+static void show_front(void) {
+    dispi_write(VBE_DISPI_INDEX_Y_OFFSET, front_page * page_rows + scroll_y);
+}
+
+// True when drawing is hidden until vbe_swap
+static inline bool buffered(void) {
+    return backbuffer || page_count > 1;
+}
 
 
 void vbe_init(void) {
@@ -20,46 +178,296 @@ void vbe_init(void) {
         // VBE not initialized by bootloader or failed
         return;
     }
-
-    framebuffer = (uint32_t*)vbe_info->framebuffer;
+    
+    // Palette modes aren't supported
+    fmt = pixfmt_select(vbe_info);
+    if (!fmt) return;
+    bytes_pp = fmt->bytes;
+    
+    framebuffer = (uint8_t*)vbe_info->framebuffer;
     screen_width = vbe_info->width;
     screen_height = vbe_info->height;
+    dispi_detect();
+    vbe_reset_clip();
+    
+    for (int i = 0; i < VBE_GLYPH_SLOTS; i++) glyph_slots[i].last_used = 0;
+    glyph_clock = 0;
     
     // Clear screen to Initial Blue (OpenWare branding)
-    vbe_clear(0x00003366); 
+    vbe_clear(term_bg);
     
     // Draw an welcome rectangle
     vbe_draw_rect(screen_width / 2 - 100, screen_height / 2 - 50, 200, 100, COLOR_WHITE);
 }
 
-void vbe_putpixel(int x, int y, uint32_t color) {
-    if (x < 0 || x >= (int)screen_width || y < 0 || y >= (int)screen_height) {
-        return;
+int vbe_get_width(void) {
+    return screen_width;
+}
+
+int vbe_get_height(void) {
+    return screen_height;
+}
+
+void vbe_set_clip(int x, int y, int w, int h) {
+    int x1 = x + w > (int)screen_width ? (int)screen_width : x + w;
+    int y1 = y + h > (int)screen_height ? (int)screen_height : y + h;
+    clip.x = x < 0 ? 0 : x;
+    clip.y = y < 0 ? 0 : y;
+    clip.w = x1 > clip.x ? x1 - clip.x : 0;
+    clip.h = y1 > clip.y ? y1 - clip.y : 0;
+}
+
+void vbe_reset_clip(void) {
+    vbe_set_clip(0, 0, screen_width, screen_height);
+}
+
+// Clip a rectangle to the clip area; false if nothing is left
+static bool clip_rect(int* x, int* y, int* w, int* h) {
+    int x0 = *x > clip.x ? *x : clip.x;
+    int y0 = *y > clip.y ? *y : clip.y;
+    int x1 = *x + *w < clip.x + clip.w ? *x + *w : clip.x + clip.w;
+    int y1 = *y + *h < clip.y + clip.h ? *y + *h : clip.y + clip.h;
+    if (x0 >= x1 || y0 >= y1) return false;
+    
+    *x = x0;
+    *y = y0;
+    *w = x1 - x0;
+    *h = y1 - y0;
+    return true;
+}
+
+static inline bool in_clip(int x, int y) {
+    return x >= clip.x && x < clip.x + clip.w && y >= clip.y && y < clip.y + clip.h;
+}
+
+// Start of row y in whichever buffer we draw to
+static inline uint8_t* row_ptr(int y) {
+    if (backbuffer) return backbuffer + y * back_pitch;
+    return vram_row(draw_page, scroll_y + y);
+}
+
+static inline uint8_t* pixel_ptr(int x, int y) {
+    return row_ptr(y) + x * (int)bytes_pp;
+}
+
+static inline uint32_t cursor_color(char c) {
+    return fmt->encode(c == 'X' ? COLOR_BLACK : COLOR_WHITE);
+}
+
+// Save what lies under the cursor, then draw the sprite over it
+static void cursor_paint(void) {
+    vbe_rect_t screen = { 0, 0, screen_width, screen_height };
+    vbe_rect_t r = { cursor_x, cursor_y, VBE_CURSOR_W, VBE_CURSOR_H };
+    if (!rect_intersect(&r, &screen, &cursor_under)) return;
+    
+    uint32_t bytes = cursor_under.w * bytes_pp;
+    for (int i = 0; i < cursor_under.h; i++) {
+        int y = cursor_under.y + i;
+        span_copy(cursor_save + i * VBE_CURSOR_W * 4, pixel_ptr(cursor_under.x, y), bytes);
+        
+        const char* row = cursor_sprite[y - cursor_y];
+        for (int x = cursor_under.x; x < cursor_under.x + cursor_under.w; x++) {
+            char c = row[x - cursor_x];
+            if (c != ' ') fmt->put(pixel_ptr(x, y), cursor_color(c));
+        }
+    }
+    cursor_drawn = true;
+}
+
+// Put back the pixels the cursor covers
+static void cursor_restore(void) {
+    if (!cursor_drawn) return;
+    cursor_drawn = false;
+    
+    uint32_t bytes = cursor_under.w * bytes_pp;
+    for (int i = 0; i < cursor_under.h; i++) {
+        span_copy(pixel_ptr(cursor_under.x, cursor_under.y + i), cursor_save + i * VBE_CURSOR_W * 4, bytes);
     }
+}
 
-    // Assuming 32-bit color (RGBA) - 4 bytes per pixel
-    // offset = y * pitch + x * 4
-    // Since we use uint32_t* pointer, we divide pitch by 4
-    uint32_t* target = backbuffer ? backbuffer : framebuffer;
-    target[y * (vbe_info->pitch / 4) + x] = color;
+/*
+ * Without buffering the cursor stays on screen between swaps, so it is
+ * taken off before anything is drawn and vbe_swap puts it back on top
+ */
+static inline void lift_cursor(void) {
+    if (cursor_drawn) cursor_restore();
 }
 
+/**
+ * Record that a screen area changed and must reach the framebuffer on the
+ * next vbe_swap
+ */
+void vbe_mark_dirty(int x, int y, int w, int h) {
+    if (!buffered()) return;    // Drawing went straight to the screen
+    
+    // Clip to the screen
+    if (x < 0) { w += x; x = 0; }
+    if (y < 0) { h += y; y = 0; }
+    if (x + w > (int)screen_width) w = screen_width - x;
+    if (y + h > (int)screen_height) h = screen_height - y;
+    if (w <= 0 || h <= 0) return;
+    
+    vbe_rect_t r = { x, y, w, h };
+    region_add(&dirty, &r);
+}
 
+void vbe_putpixel(int x, int y, uint32_t color) {
+    if (!in_clip(x, y)) return;
+    
+    lift_cursor();
+    fmt->put(pixel_ptr(x, y), fmt->encode(color));
+    vbe_mark_dirty(x, y, 1, 1);
+}
+
+
+/**
+ * Fill the clip rectangle (the whole screen unless one is set)
+ */
 void vbe_clear(uint32_t color) {
-    uint32_t* target = backbuffer ? backbuffer : framebuffer;
-    // Optimized fill for 32-bit
-    for (uint32_t i = 0; i < screen_width * screen_height; i++) {
-        target[i] = color;
-    }
+    vbe_draw_rect(clip.x, clip.y, clip.w, clip.h, color);
 }
 
 
 void vbe_draw_rect(int x, int y, int w, int h, uint32_t color) {
+    // Clip once, then fill whole rows
+    if (!clip_rect(&x, &y, &w, &h)) return;
+    
+    lift_cursor();
+    uint32_t pixel = fmt->encode(color);
     for (int i = 0; i < h; i++) {
-        for (int j = 0; j < w; j++) {
-            vbe_putpixel(x + j, y + i, color);
+        fmt->fill(pixel_ptr(x, y + i), pixel, w);
+    }
+    vbe_mark_dirty(x, y, w, h);
+}
+
+void vbe_hline(int x, int y, int w, uint32_t color) {
+    vbe_draw_rect(x, y, w, 1, color);
+}
+
+void vbe_vline(int x, int y, int h, uint32_t color) {
+    int w = 1;
+    if (!clip_rect(&x, &y, &w, &h)) return;
+    
+    lift_cursor();
+    uint32_t pixel = fmt->encode(color);
+    for (int i = 0; i < h; i++) {
+        fmt->put(pixel_ptr(x, y + i), pixel);
+    }
+    vbe_mark_dirty(x, y, 1, h);
+}
+
+/**
+ * Copy a w x h block of 0x00RRGGBB pixels to (x, y), converting them to the
+ * screen format; 'stride' is the distance in pixels between the source rows
+ */
+void vbe_blit(int x, int y, const uint32_t* src, int stride, int w, int h) {
+    int cx = x, cy = y;
+    if (!clip_rect(&cx, &cy, &w, &h)) return;
+    
+    lift_cursor();
+    src += (cy - y) * stride + (cx - x);
+    for (int i = 0; i < h; i++) {
+        fmt->blit(pixel_ptr(cx, cy + i), src, w);
+        src += stride;
+    }
+    vbe_mark_dirty(cx, cy, w, h);
+}
+
+/**
+ * Blend onto 'n' screen pixels at 'p': the 0xAARRGGBB pixels of 'src', or
+ * 'color' with its own alpha if 'src' is NULL. Formats other than
+ * 0x00RRGGBB are converted there and back a chunk at a time.
+ */
+static void blend_span(uint8_t* p, const uint32_t* src, uint32_t color, uint32_t n) {
+    if (fmt->direct) {
+        if (src) span_blend32((uint32_t*)p, src, n);
+        else span_blend_fill32((uint32_t*)p, color, n);
+        return;
+    }
+    
+    while (n) {
+        uint32_t count = n < VBE_BLEND_CHUNK ? n : VBE_BLEND_CHUNK;
+        fmt->read(blend_pixels, p, count);
+        if (src) {
+            span_blend32(blend_pixels, src, count);
+            src += count;
+        } else {
+            span_blend_fill32(blend_pixels, color, count);
         }
+        fmt->blit(p, blend_pixels, count);
+        p += count * bytes_pp;
+        n -= count;
+    }
+}
+
+/**
+ * Fill a rectangle with a translucent color; its top byte is the opacity,
+ * from 0 (invisible) to 255 (same as vbe_draw_rect)
+ */
+void vbe_blend_rect(int x, int y, int w, int h, uint32_t color) {
+    uint32_t alpha = color >> 24;
+    if (alpha == 0) return;
+    if (alpha == 255) {
+        vbe_draw_rect(x, y, w, h, color & 0x00FFFFFF);
+        return;
+    }
+    if (!clip_rect(&x, &y, &w, &h)) return;
+    
+    lift_cursor();
+    for (int i = 0; i < h; i++) {
+        blend_span(pixel_ptr(x, y + i), NULL, color, w);
     }
+    vbe_mark_dirty(x, y, w, h);
+}
+
+/**
+ * Like vbe_blit, but the source pixels are 0xAARRGGBB and each is blended
+ * with its own alpha
+ */
+void vbe_blend_blit(int x, int y, const uint32_t* src, int stride, int w, int h) {
+    int cx = x, cy = y;
+    if (!clip_rect(&cx, &cy, &w, &h)) return;
+    
+    lift_cursor();
+    src += (cy - y) * stride + (cx - x);
+    for (int i = 0; i < h; i++) {
+        blend_span(pixel_ptr(cx, cy + i), src, 0, w);
+        src += stride;
+    }
+    vbe_mark_dirty(cx, cy, w, h);
+}
+
+/**
+ * Move a block of the screen from (sx, sy) to (dx, dy). The areas may
+ * overlap: rows are walked away from the destination so none is
+ * overwritten before it has been read.
+ */
+void vbe_copy_rect(int sx, int sy, int dx, int dy, int w, int h) {
+    lift_cursor();
+    
+    // Only pixels that are on screen can be read
+    if (sx < 0) { w += sx; dx -= sx; sx = 0; }
+    if (sy < 0) { h += sy; dy -= sy; sy = 0; }
+    if (sx + w > (int)screen_width) w = screen_width - sx;
+    if (sy + h > (int)screen_height) h = screen_height - sy;
+    if (w <= 0 || h <= 0) return;
+    
+    int cx = dx, cy = dy;
+    if (!clip_rect(&cx, &cy, &w, &h)) return;
+    sx += cx - dx;
+    sy += cy - dy;
+    
+    uint32_t bytes = w * bytes_pp;
+    if (cy > sy) {
+        for (int i = h - 1; i >= 0; i--) {
+            span_move(pixel_ptr(cx, cy + i), pixel_ptr(sx, sy + i), bytes);
+        }
+    } else {
+        for (int i = 0; i < h; i++) {
+            span_move(pixel_ptr(cx, cy + i), pixel_ptr(sx, sy + i), bytes);
+        }
+    }
+    vbe_mark_dirty(cx, cy, w, h);
 }
 
 static int abs(int x) {
@@ -67,15 +475,32 @@ static int abs(int x) {
 }
 
 void vbe_draw_line(int x0, int y0, int x1, int y1, uint32_t color) {
+    // Straight lines are spans
+    if (y0 == y1) {
+        vbe_hline(x0 < x1 ? x0 : x1, y0, abs(x1 - x0) + 1, color);
+        return;
+    }
+    if (x0 == x1) {
+        vbe_vline(x0, y0 < y1 ? y0 : y1, abs(y1 - y0) + 1, color);
+        return;
+    }
+    if (!fmt) return;
+    
     int dx = abs(x1 - x0);
     int dy = -abs(y1 - y0);
     int sx = (x0 < x1) ? 1 : -1;
     int sy = (y0 < y1) ? 1 : -1;
     int err = dx + dy;
     int e2;
-
+    
+    lift_cursor();
+    uint32_t pixel = fmt->encode(color);
+    
+    // One bounding box for the whole line instead of one per pixel
+    vbe_mark_dirty(x0 < x1 ? x0 : x1, y0 < y1 ? y0 : y1, dx + 1, -dy + 1);
+    
     while (1) {
-        vbe_putpixel(x0, y0, color);
+        if (in_clip(x0, y0)) fmt->put(pixel_ptr(x0, y0), pixel);
         if (x0 == x1 && y0 == y1) break;
         e2 = 2 * err;
         if (e2 >= dy) {
@@ -89,36 +514,337 @@ void vbe_draw_line(int x0, int y0, int x1, int y1, uint32_t color) {
     }
 }
 
-static uint32_t* backbuffer = NULL;
-
 void vbe_enable_double_buffering(void) {
-    if (backbuffer) return;
+    if (!fmt || buffered()) return;
+    lift_cursor();
+    uint32_t row_bytes = screen_width * bytes_pp;
     
-    uint32_t size = screen_width * screen_height * sizeof(uint32_t);
+    // Two pages of video memory: flip between them, no copy through RAM
+    if (hw_start && virt_rows >= 2 * screen_height) {
+        // Both pages start out showing the current screen at row 0
+        for (uint32_t y = 0; y < screen_height; y++) {
+            span_copy(vram_row(0, y), vram_row(0, scroll_y + y), row_bytes);
+        }
+        page_rows = virt_rows / 2;
+        scroll_y = 0;
+        for (uint32_t y = 0; y < screen_height; y++) {
+            span_copy(vram_row(1, y), vram_row(0, y), row_bytes);
+        }
+        page_count = 2;
+        front_page = 0;
+        draw_page = 1;
+        show_front();
+        return;
+    }
+    
+    uint32_t size = row_bytes * screen_height;
     // Note: We need a kmalloc that can handle ~3MB if 1024x768x32.
     // Our heap in memory.h needs to be big enough.
-    backbuffer = (uint32_t*)kmalloc(size);
-    if (backbuffer) {
-        kmemset(backbuffer, 0, size);
+    uint8_t* buffer = (uint8_t*)kmalloc(size);
+    if (buffer) {
+        // Start from what is on screen now
+        for (uint32_t y = 0; y < screen_height; y++) {
+            span_copy(buffer + y * row_bytes, row_ptr(y), row_bytes);
+        }
+        back_pitch = row_bytes;
+        backbuffer = buffer;
     }
 }
 
+/**
+ * Flip to the page we drew into, then bring the other page up to date by
+ * copying over what changed this frame
+ */
+static void flip(void) {
+    front_page = draw_page;
+    draw_page ^= 1;
+    show_front();
+    
+    for (int i = 0; i < dirty.count; i++) {
+        vbe_rect_t* r = &dirty.rects[i];
+        uint32_t offset = r->x * bytes_pp;
+        uint32_t bytes = r->w * bytes_pp;
+        
+        for (int row = 0; row < r->h; row++) {
+            uint32_t y = scroll_y + r->y + row;
+            span_copy(vram_row(draw_page, y) + offset, vram_row(front_page, y) + offset, bytes);
+        }
+    }
+    region_clear(&dirty);
+}
+
+// Copy the dirty parts of the backbuffer to the screen
+static void present(void) {
+    for (int i = 0; i < dirty.count; i++) {
+        vbe_rect_t* r = &dirty.rects[i];
+        uint32_t bytes = r->w * bytes_pp;
+        uint8_t* src = backbuffer + r->y * back_pitch + r->x * bytes_pp;
+        uint8_t* dst = framebuffer + r->y * vbe_info->pitch + r->x * bytes_pp;
+        
+        for (int row = 0; row < r->h; row++) {
+            span_copy(dst, src, bytes);
+            src += back_pitch;
+            dst += vbe_info->pitch;
+        }
+    }
+    region_clear(&dirty);
+}
+
+/**
+ * Put this frame on screen with the cursor on top. Besides what was drawn,
+ * only the cursor's old and new rectangles are copied when it has moved.
+ */
 void vbe_swap(void) {
-    if (!backbuffer) return;
-    kmemcpy(framebuffer, backbuffer, screen_width * screen_height * sizeof(uint32_t));
+    if (!fmt) return;
+    
+    if (!buffered()) {
+        // Drawing went straight to the screen; just bring the cursor back on top
+        lift_cursor();
+        if (cursor_visible) cursor_paint();
+        shown_x = cursor_x;
+        shown_y = cursor_y;
+        region_clear(&dirty);
+        return;
+    }
+    
+    bool moved = !cursor_visible || cursor_x != shown_x || cursor_y != shown_y;
+    if (cursor_shown && moved) {
+        // The drawing target is clean there already
+        vbe_mark_dirty(shown_x, shown_y, VBE_CURSOR_W, VBE_CURSOR_H);
+    }
+    if (cursor_visible) {
+        cursor_paint();
+        if (!cursor_shown || moved) vbe_mark_dirty(cursor_x, cursor_y, VBE_CURSOR_W, VBE_CURSOR_H);
+    }
+    cursor_shown = cursor_visible;
+    shown_x = cursor_x;
+    shown_y = cursor_y;
+    
+    if (page_count > 1) {
+        flip();
+    } else {
+        present();
+    }
+    cursor_restore();
+}
+
+// True if the next vbe_swap would change what is on screen
+static bool has_damage(void) {
+    bool moved = cursor_x != shown_x || cursor_y != shown_y;
+    if (!buffered()) return cursor_visible && (!cursor_drawn || moved);
+    return dirty.count > 0 || cursor_visible != cursor_shown || (cursor_visible && moved);
+}
+
+/**
+ * Timer hook (interrupt context): let a frame fall due at the refresh
+ * rate. A frame that fell due and is still waiting with damage when the
+ * next one comes has been dropped.
+ */
+void vbe_frame_tick(void) {
+    uint32_t tick_hz = timer_get_hz();
+    if (!refresh_hz || !tick_hz) return;
+    
+    frame_phase += refresh_hz;
+    if (frame_phase < tick_hz) return;
+    frame_phase -= tick_hz;
+    
+    frame_stats.frames++;
+    if (frame_due && has_damage()) frame_stats.dropped++;
+    frame_due = true;
+}
+
+/**
+ * Present at most 'hz' frames a second from the timer (0 turns pacing off
+ * and every vbe_present goes straight out). Rates above the tick rate are
+ * capped to it.
+ */
+void vbe_set_refresh(int hz) {
+    uint32_t tick_hz = timer_get_hz();
+    if (hz < 0) hz = 0;
+    if ((uint32_t)hz > tick_hz) hz = tick_hz;
+    
+    __asm__ volatile("cli");
+    refresh_hz = hz;
+    frame_phase = 0;
+    frame_due = false;
+    frame_stats.frames = 0;
+    frame_stats.dropped = 0;
+    __asm__ volatile("sti");
+}
+
+// True if a frame is due (always, when unpaced)
+int vbe_frame_ready(void) {
+    return !refresh_hz || frame_due;
+}
+
+/**
+ * Present the damage gathered since the last frame, if there is any, and
+ * time it. Callers check vbe_frame_ready() first so bursts of drawing
+ * cost one swap per frame.
+ */
+void vbe_present(void) {
+    if (!fmt) return;
+    frame_due = false;
+    if (!has_damage()) return;
+    
+    uint64_t start = cpu_rdtsc();
+    vbe_swap();
+    uint32_t cycles = (uint32_t)(cpu_rdtsc() - start);
+    
+    frame_stats.presented++;
+    uint32_t per_us = timer_tsc_per_us();
+    if (!per_us) return;        // Not calibrated yet
+    
+    uint32_t us = cycles / per_us;
+    frame_stats.timed++;
+    frame_stats.present_us_last = us;
+    frame_stats.present_us_total += us;
+    if (us > frame_stats.present_us_max) frame_stats.present_us_max = us;
+}
+
+void vbe_get_frame_stats(vbe_frame_stats_t* stats) {
+    *stats = frame_stats;
+    stats->refresh_hz = refresh_hz;
+}
+
+/**
+ * Move the pointer sprite (its top left hot spot). Nothing is drawn until
+ * the next vbe_swap, so this is cheap enough to call on every mouse event.
+ */
+void vbe_set_cursor(int x, int y) {
+    cursor_x = x;
+    cursor_y = y;
+}
+
+void vbe_show_cursor(int visible) {
+    cursor_visible = visible != 0;
+}
+
+/**
+ * Clip a cell 8 rows high and w pixels wide at (x, y) to the clip area:
+ * the visible rows [*r0, *r1) and columns [*c0, *c1) of the cell. Returns
+ * false if nothing is visible.
+ */
+static bool clip_cell(int x, int y, int w, int* r0, int* r1, int* c0, int* c1) {
+    *r0 = y < clip.y ? clip.y - y : 0;
+    *r1 = y + 8 > clip.y + clip.h ? clip.y + clip.h - y : 8;
+    *c0 = x < clip.x ? clip.x - x : 0;
+    *c1 = x + w > clip.x + clip.w ? clip.x + clip.w - x : w;
+    return *r0 < *r1 && *c0 < *c1;
 }
 
 void vbe_draw_char(int x, int y, char c, uint32_t color) {
-    if (c > 127) return;
+    if ((uint8_t)c > 127) return;
     
     uint8_t* glyph = font8x8_basic[(int)c];
+    int r0, r1, c0, c1;
+    if (!clip_cell(x, y, 8, &r0, &r1, &c0, &c1)) return;
     
-    for (int i = 0; i < 8; i++) {
-        for (int j = 0; j < 8; j++) {
-            if (glyph[i] & (1 << (7 - j))) {
-                vbe_putpixel(x + j, y + i, color);
+    lift_cursor();
+    uint32_t pixel = fmt->encode(color);
+    for (int i = r0; i < r1; i++) {
+        if (glyph[i]) fmt->glyph(pixel_ptr(x, y + i), glyph[i], c0, c1, pixel);
+    }
+    vbe_mark_dirty(x + c0, y + r0, c1 - c0, r1 - r0);
+}
+
+// Slot holding the glyphs for fg/bg, taking over the least recently used one
+static glyph_slot_t* glyph_slot(uint32_t fg, uint32_t bg) {
+    glyph_slot_t* victim = &glyph_slots[0];
+    
+    for (int i = 0; i < VBE_GLYPH_SLOTS; i++) {
+        glyph_slot_t* slot = &glyph_slots[i];
+        if (slot->last_used && slot->fg == fg && slot->bg == bg) {
+            slot->last_used = ++glyph_clock;
+            return slot;
+        }
+        if (slot->last_used < victim->last_used) victim = slot;
+    }
+    
+    victim->fg = fg;
+    victim->bg = bg;
+    for (int i = 0; i < 4; i++) victim->valid[i] = 0;
+    victim->last_used = ++glyph_clock;
+    return victim;
+}
+
+// Rows of glyph c in a slot (8 pixels each), expanding it first if needed
+static uint8_t* glyph_rows(glyph_slot_t* slot, uint8_t c) {
+    uint8_t* px = glyph_pixels[slot - glyph_slots] + c * 64 * bytes_pp;
+    
+    if (!(slot->valid[c >> 5] & (1u << (c & 31)))) {
+        uint32_t fg = fmt->encode(slot->fg);
+        uint32_t bg = fmt->encode(slot->bg);
+        for (int i = 0; i < 8; i++) {
+            uint8_t bits = font8x8_basic[c][i];
+            for (int j = 0; j < 8; j++) {
+                fmt->put(px + (i * 8 + j) * bytes_pp, (bits & (0x80 >> j)) ? fg : bg);
             }
         }
+        slot->valid[c >> 5] |= 1u << (c & 31);
+    }
+    return px;
+}
+
+/**
+ * Draw 'len' characters on one line with an opaque background. The span is
+ * clipped once, then every visible scanline is written left to right from
+ * the expanded glyph rows.
+ */
+static void draw_text_span(int x, int y, const char* str, int len, uint32_t fg, uint32_t bg) {
+    int r0, r1, c0, c1;
+    if (len <= 0 || !clip_cell(x, y, len * 8, &r0, &r1, &c0, &c1)) return;
+    
+    lift_cursor();
+    int first = c0 / 8;
+    int last = (c1 + 7) / 8;            // One past the last visible character
+    glyph_slot_t* slot = glyph_slot(fg, bg);
+    
+    // Expand everything up front so the row loop below is plain copies
+    for (int i = first; i < last; i++) {
+        uint8_t c = (uint8_t)str[i];
+        glyph_rows(slot, c > 127 ? 0 : c);
+    }
+    
+    uint8_t* glyphs = glyph_pixels[slot - glyph_slots];
+    uint32_t glyph_bytes = 64 * bytes_pp;
+    uint32_t row_words = 2 * bytes_pp;      // 8 pixels
+    for (int r = r0; r < r1; r++) {
+        uint8_t* row = pixel_ptr(x, y + r);
+        
+        for (int i = first; i < last; i++) {
+            uint8_t c = (uint8_t)str[i];
+            const uint8_t* src = glyphs + (c > 127 ? 0 : c) * glyph_bytes + r * 8 * bytes_pp;
+            uint8_t* dst = row + i * 8 * bytes_pp;
+            int j0 = c0 - i * 8 > 0 ? c0 - i * 8 : 0;
+            int j1 = c1 - i * 8 < 8 ? c1 - i * 8 : 8;
+            
+            if (j0 == 0 && j1 == 8) {
+                for (uint32_t k = 0; k < row_words; k++) {
+                    ((uint32_t*)dst)[k] = ((const uint32_t*)src)[k];
+                }
+            } else {
+                span_copy(dst + j0 * bytes_pp, src + j0 * bytes_pp, (j1 - j0) * bytes_pp);
+            }
+        }
+    }
+    vbe_mark_dirty(x + c0, y + r0, c1 - c0, r1 - r0);
+}
+
+/**
+ * Draw a string with an opaque background ('\n' starts a new line at x)
+ */
+void vbe_draw_text(int x, int y, const char* str, uint32_t fg, uint32_t bg) {
+    while (*str) {
+        int len = 0;
+        while (str[len] && str[len] != '\n') len++;
+        
+        draw_text_span(x, y, str, len, fg, bg);
+        str += len;
+        if (*str == '\n') {
+            str++;
+            y += 8;
+        }
     }
 }
 
@@ -136,36 +862,86 @@ void vbe_draw_string(int x, int y, const char* str, uint32_t color) {
     }
 }
 
+/**
+ * Move the screen contents up by 'rows' and clear the rows that come in at
+ * the bottom. With a movable display start this only changes the start
+ * row; the visible rows are copied back to the top of the page when we run
+ * out of video memory below them.
+ */
+static void scroll_up(uint32_t rows) {
+    uint32_t keep = screen_height - rows;
+    uint32_t row_bytes = screen_width * bytes_pp;
+    
+    lift_cursor();
+    
+    if (backbuffer || !hw_start) {
+        for (uint32_t y = 0; y < keep; y++) {
+            span_copy(row_ptr(y), row_ptr(y + rows), row_bytes);
+        }
+        vbe_mark_dirty(0, 0, screen_width, screen_height);
+    } else if (scroll_y + rows + screen_height <= page_rows) {
+        scroll_y += rows;
+        
+        // Damage not yet flipped moved up with the content
+        region_t moved = dirty;
+        region_clear(&dirty);
+        for (int i = 0; i < moved.count; i++) {
+            vbe_rect_t* r = &moved.rects[i];
+            vbe_mark_dirty(r->x, r->y - (int)rows, r->w, r->h);
+        }
+        
+        // So does the cursor on the front page, which the next flip hides
+        if (cursor_shown) vbe_mark_dirty(shown_x, shown_y - (int)rows, VBE_CURSOR_W, VBE_CURSOR_H);
+    } else {
+        for (uint32_t y = 0; y < keep; y++) {
+            span_copy(vram_row(draw_page, y), vram_row(draw_page, scroll_y + rows + y), row_bytes);
+        }
+        scroll_y = 0;
+        vbe_mark_dirty(0, 0, screen_width, screen_height);
+    }
+    
+    uint32_t bg = fmt->encode(term_bg);
+    for (uint32_t y = keep; y < screen_height; y++) {
+        fmt->fill(row_ptr(y), bg, screen_width);
+    }
+    vbe_mark_dirty(0, keep, screen_width, rows);
+    
+    // A single page is on screen already; two pages move on the next flip
+    if (hw_start && page_count == 1) show_front();
+}
+
 void vbe_print(const char* str, uint32_t color) {
+    if (!fmt) return;
+    
     while (*str) {
         if (*str == '\n') {
             term_x = 0;
             term_y += 8;
+            str++;
         } else if (*str == '\r') {
             term_x = 0;
+            str++;
         } else {
-            vbe_draw_char(term_x, term_y, *str, color);
-            term_x += 8;
-            if (term_x >= (int)screen_width) {
+            // Longest run that fits on the current line, drawn as one span
+            int room = ((int)screen_width - term_x) / 8;
+            int len = 0;
+            while (len < room && str[len] && str[len] != '\n' && str[len] != '\r') len++;
+            
+            draw_text_span(term_x, term_y, str, len, color, term_bg);
+            term_x += len * 8;
+            str += len;
+            if (term_x + 8 > (int)screen_width) {
                 term_x = 0;
                 term_y += 8;
             }
         }
-
+        
         // Scrolling
         if (term_y >= (int)screen_height - 8) {
-            uint32_t stride = screen_width * sizeof(uint32_t);
-            uint32_t line_height = 8;
-            uint32_t* target = backbuffer ? backbuffer : framebuffer;
-            
-            kmemcpy(target, target + (line_height * screen_width), (screen_height - line_height) * stride);
-            kmemset(target + ((screen_height - line_height) * screen_width), 0, line_height * stride);
+            scroll_up(8);
             term_y -= 8;
         }
-        str++;
     }
     
-    if (backbuffer) vbe_swap();
+    if (buffered() && vbe_frame_ready()) vbe_present();
 }
-
-
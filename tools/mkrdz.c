@@ -0,0 +1,201 @@
+/**
+ * OpenWare OS - Compressed Ramdisk Image Builder (host tool)
+ * Copyright (c) 2026 Ventryx Inc. All rights reserved.
+ *
+ * Usage: mkrdz <raw image> <output>
+ *
+ * Splits a raw disk image into 64KB chunks and compresses each one
+ * independently as an LZ4 block, so the kernel can decompress any chunk
+ * on first access. Layout (little endian, see kernel/ramdisk.h):
+ *
+ *   char     magic[4]             "RDZ1"
+ *   uint32_t chunk_size
+ *   uint32_t image_size           uncompressed bytes
+ *   uint32_t chunk_count
+ *   uint32_t offset[chunk_count + 1]  chunk i is bytes [offset[i], offset[i+1])
+ *   chunk data...
+ *
+ * A chunk whose stored size equals its uncompressed size is stored raw,
+ * and an all-zero chunk is stored as nothing at all (stored size 0).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#define RDZ_MAGIC       "RDZ1"
+#define RDZ_CHUNK_SIZE  65536
+
+#define HASH_BITS       14
+#define MIN_MATCH       4
+#define LAST_LITERALS   5       /* The last 5 bytes must be literals */
+#define MF_LIMIT        12      /* The last match must start 12 bytes before the end */
+#define MAX_OFFSET      65535
+
+static uint32_t read32(const uint8_t* p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return v;
+}
+
+static uint32_t hash32(uint32_t v) {
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+static uint8_t* put_length(uint8_t* op, uint32_t len) {
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = (uint8_t)len;
+    return op;
+}
+
+static uint8_t* put_sequence(uint8_t* op, const uint8_t* lit, uint32_t lit_len,
+                             uint32_t offset, uint32_t match_len) {
+    uint8_t* token = op++;
+    *token = (uint8_t)((lit_len >= 15 ? 15 : lit_len) << 4);
+    if (lit_len >= 15) op = put_length(op, lit_len - 15);
+    memcpy(op, lit, lit_len);
+    op += lit_len;
+
+    if (match_len == 0) return op;  /* Final literal-only sequence */
+
+    *op++ = (uint8_t)offset;
+    *op++ = (uint8_t)(offset >> 8);
+    match_len -= MIN_MATCH;
+    *token |= (uint8_t)(match_len >= 15 ? 15 : match_len);
+    if (match_len >= 15) op = put_length(op, match_len - 15);
+    return op;
+}
+
+/*
+ * Greedy LZ4 block compressor. dst must hold at least n + n/255 + 16
+ * bytes. Returns the compressed size.
+ */
+static uint32_t lz4_compress(const uint8_t* src, uint32_t n, uint8_t* dst) {
+    static int32_t table[1 << HASH_BITS];
+    uint8_t* op = dst;
+    uint32_t ip = 0;
+    uint32_t anchor = 0;
+
+    for (uint32_t i = 0; i < (1u << HASH_BITS); i++) table[i] = -1;
+
+    if (n > MF_LIMIT) {
+        while (ip < n - MF_LIMIT) {
+            uint32_t seq = read32(src + ip);
+            uint32_t h = hash32(seq);
+            int32_t ref = table[h];
+            table[h] = (int32_t)ip;
+
+            if (ref < 0 || ip - (uint32_t)ref > MAX_OFFSET || read32(src + ref) != seq) {
+                ip++;
+                continue;
+            }
+
+            uint32_t len = MIN_MATCH;
+            while (ip + len < n - LAST_LITERALS && src[ref + len] == src[ip + len]) len++;
+
+            op = put_sequence(op, src + anchor, ip - anchor, ip - (uint32_t)ref, len);
+            ip += len;
+            anchor = ip;
+        }
+    }
+
+    op = put_sequence(op, src + anchor, n - anchor, 0, 0);
+    return (uint32_t)(op - dst);
+}
+
+static int all_zero(const uint8_t* p, uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        if (p[i]) return 0;
+    }
+    return 1;
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+int main(int argc, char** argv) {
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s <raw image> <output>\n", argv[0]);
+        return 1;
+    }
+
+    FILE* in = fopen(argv[1], "rb");
+    if (!in) {
+        perror(argv[1]);
+        return 1;
+    }
+    fseek(in, 0, SEEK_END);
+    long size = ftell(in);
+    fseek(in, 0, SEEK_SET);
+    if (size <= 0 || size % 512 != 0) {
+        fprintf(stderr, "%s: image size must be a non-zero multiple of 512\n", argv[1]);
+        fclose(in);
+        return 1;
+    }
+
+    uint8_t* image = malloc((size_t)size);
+    if (!image || fread(image, 1, (size_t)size, in) != (size_t)size) {
+        fprintf(stderr, "%s: read failed\n", argv[1]);
+        fclose(in);
+        return 1;
+    }
+    fclose(in);
+
+    uint32_t chunk_count = (uint32_t)((size + RDZ_CHUNK_SIZE - 1) / RDZ_CHUNK_SIZE);
+    uint32_t header_size = 16 + (chunk_count + 1) * 4;
+    uint8_t* header = calloc(1, header_size);
+    uint8_t* out = malloc(RDZ_CHUNK_SIZE + RDZ_CHUNK_SIZE / 255 + 16);
+    FILE* outf = fopen(argv[2], "wb");
+    if (!header || !out || !outf) {
+        perror(argv[2]);
+        return 1;
+    }
+
+    memcpy(header, RDZ_MAGIC, 4);
+    put32(header + 4, RDZ_CHUNK_SIZE);
+    put32(header + 8, (uint32_t)size);
+    put32(header + 12, chunk_count);
+
+    /* Header first (offsets patched in afterwards) */
+    fwrite(header, 1, header_size, outf);
+
+    uint32_t pos = header_size;
+    for (uint32_t i = 0; i < chunk_count; i++) {
+        uint32_t start = i * RDZ_CHUNK_SIZE;
+        uint32_t len = (uint32_t)size - start;
+        if (len > RDZ_CHUNK_SIZE) len = RDZ_CHUNK_SIZE;
+
+        put32(header + 16 + i * 4, pos);
+        if (all_zero(image + start, len)) continue;
+
+        uint32_t clen = lz4_compress(image + start, len, out);
+        if (clen < len) {
+            fwrite(out, 1, clen, outf);
+            pos += clen;
+        } else {
+            fwrite(image + start, 1, len, outf);  /* Incompressible: store raw */
+            pos += len;
+        }
+    }
+    put32(header + 16 + chunk_count * 4, pos);
+
+    fseek(outf, 0, SEEK_SET);
+    fwrite(header, 1, header_size, outf);
+    fclose(outf);
+
+    printf("mkrdz: %ld bytes -> %u bytes (%u chunks of %u KB)\n",
+           size, pos, chunk_count, RDZ_CHUNK_SIZE / 1024);
+
+    free(out);
+    free(header);
+    free(image);
+    return 0;
+}